@@ -196,6 +196,16 @@ public:
     compute_matrices();
   }
 
+  // Largura, em unidades de mundo, da área vista por um pixel a uma distância
+  // 'dist' do olho, para uma imagem com 'image_width' colunas. Nas projeções
+  // paralelas ela é constante. Usada na escolha do nível de mipmap.
+  double pixel_footprint(double dist, int image_width) const {
+    double pixel = (xmax - xmin) / image_width;
+    if (projection == ProjectionType::PERSPECTIVE)
+      return pixel * dist / focal_distance;
+    return pixel;
+  }
+
   point3 world_to_camera(const point3 &p) const {
     vec4 p4(p, 1.0);
     vec4 result = Mwc * p4;
@@ -6,6 +6,21 @@
 #include <algorithm>
 #include <cmath>
 
+// Dados do raio usados no teste de slabs, calculados uma vez por raio em vez
+// de uma vez por caixa visitada: o inverso da direção (três divisões) e, por
+// eixo, se a direção é negativa (a face de entrada é a do máximo).
+struct ray_query {
+  point3 origin;
+  vec3 inv_dir;
+  bool sign[3];
+
+  explicit ray_query(const ray &r) : origin(r.origin()) {
+    for (int a = 0; a < 3; a++) {
+      inv_dir.e[a] = 1.0 / r.direction()[a];
+      sign[a] = inv_dir.e[a] < 0.0;
+    }
+  }
+};
 
 class aabb {
 public:
@@ -19,21 +34,33 @@ public:
   point3 max() const { return maximum; }
 
   bool hit(const ray &r, double t_min, double t_max) const {
-    for (int a = 0; a < 3; a++) {
-      double invD = 1.0 / r.direction()[a];
-      double t0 = (minimum[a] - r.origin()[a]) * invD;
-      double t1 = (maximum[a] - r.origin()[a]) * invD;
+    return hit(ray_query(r), t_min, t_max);
+  }
 
-      if (invD < 0.0)
-        std::swap(t0, t1);
+  // Teste de slabs sem desvios: a face de entrada de cada eixo sai de um
+  // par {mínimo, máximo} indexado pelo sinal guardado em 'q' (um load, não
+  // um salto), e os intervalos são cortados com máximo/mínimo (maxsd/minsd).
+  // As comparações ficam na forma "t0 > t_min ? t0 : t_min" para que um NaN
+  // (0 * inf, raio paralelo sobre a face) deixe o intervalo como está, como
+  // no teste com troca de antes.
+  bool hit(const ray_query &q, double t_min, double t_max) const {
+    double t_entry;
+    return hit(q, t_min, t_max, t_entry);
+  }
 
+  // Como acima, devolvendo em 't_entry' onde o raio entra na caixa (t_min,
+  // se a origem já estiver dentro). Usado para ordenar os filhos da BVH.
+  bool hit(const ray_query &q, double t_min, double t_max,
+           double &t_entry) const {
+    for (int a = 0; a < 3; a++) {
+      const double bounds[2] = {minimum[a], maximum[a]};
+      double t0 = (bounds[q.sign[a]] - q.origin[a]) * q.inv_dir[a];
+      double t1 = (bounds[!q.sign[a]] - q.origin[a]) * q.inv_dir[a];
       t_min = t0 > t_min ? t0 : t_min;
       t_max = t1 < t_max ? t1 : t_max;
-
-      if (t_max <= t_min)
-        return false;
     }
-    return true;
+    t_entry = t_min;
+    return t_min < t_max;
   }
 
   static aabb surrounding_box(const aabb &box0, const aabb &box1) {
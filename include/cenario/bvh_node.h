@@ -1,7 +1,9 @@
 #ifndef BVH_NODE_H
 #define BVH_NODE_H
 
+#include "../render_stats.h"
 #include "aabb.h"
+#include "flat_scene.h"
 #include "hittable.h"
 #include "hittable_list.h"
 #include <algorithm>
@@ -39,13 +41,15 @@ public:
   std::shared_ptr<hittable> left;
   std::shared_ptr<hittable> right;
   aabb box;
+  // Eixo em que os filhos foram ordenados: 'left' tem as coordenadas menores.
+  int axis = 0;
 
   bvh_node() {}
 
   bvh_node(std::vector<std::shared_ptr<hittable>> &objects, size_t start,
            size_t end) {
 
-    int axis = rand() % 3;
+    axis = rand() % 3;
     auto comparator = (axis == 0)   ? box_x_compare
                       : (axis == 1) ? box_y_compare
                                     : box_z_compare;
@@ -86,7 +90,7 @@ public:
 
   bool hit(const ray &r, double t_min, double t_max,
            hit_record &rec) const override {
-
+    RT_COUNT(node_visits);
     if (!box.hit(r, t_min, t_max))
       return false;
 
@@ -96,6 +100,19 @@ public:
     return hit_left || hit_right;
   }
 
+  bool hit_any(const ray &r, double t_min, double t_max,
+               const hittable *&occluder) const override {
+    RT_COUNT(node_visits);
+    if (!box.hit(r, t_min, t_max))
+      return false;
+
+    if (left->hit_any(r, t_min, t_max, occluder))
+      return true;
+
+    // Nós com um único objeto guardam o mesmo ponteiro nos dois filhos.
+    return right != left && right->hit_any(r, t_min, t_max, occluder);
+  }
+
   std::string get_name() const override { return "BVH Node"; }
 
   bool bounding_box(aabb &output_box) const override {
@@ -104,16 +121,22 @@ public:
   }
 };
 
+// Raiz da cena: a BVH dos objetos com bounding box mais a lista dos que não
+// têm (planos). Os raios percorrem a cópia achatada 'flat', montada a partir
+// de bvh_root por flatten(); bvh_root continua sendo a árvore de referência
+// (snapshot, grade de sombras) e mantém vivos os objetos que 'flat' aponta.
 class bvh_scene : public hittable {
 public:
   std::shared_ptr<bvh_node> bvh_root;
   std::vector<std::shared_ptr<hittable>> unbounded_objects;
+  flat_scene flat;
 
   bvh_scene() {}
 
   void build(std::vector<std::shared_ptr<hittable>> &all_objects) {
     std::vector<std::shared_ptr<hittable>> bounded_objects;
     unbounded_objects.clear();
+    bvh_root = nullptr;
 
     for (auto &obj : all_objects) {
       aabb temp_box;
@@ -130,28 +153,34 @@ public:
       bvh_root = std::make_shared<bvh_node>(bounded_objects, 0,
                                             bounded_objects.size());
     }
+
+    flatten();
+  }
+
+  // Refaz 'flat' a partir de bvh_root e unbounded_objects. Chamar sempre
+  // que um dos dois for trocado (build() e a leitura do snapshot já chamam).
+  void flatten() {
+    flat.clear();
+    for (const auto &obj : unbounded_objects)
+      flat.add_unbounded(*obj);
+    if (bvh_root)
+      flat.set_root(flatten_node(*bvh_root), bvh_root->box);
   }
 
   bool hit(const ray &r, double t_min, double t_max,
            hit_record &rec) const override {
-    hit_record temp_rec;
-    bool hit_anything = false;
-    double closest_so_far = t_max;
-
-    for (const auto &obj : unbounded_objects) {
-      if (obj->hit(r, t_min, closest_so_far, temp_rec)) {
-        hit_anything = true;
-        closest_so_far = temp_rec.t;
-        rec = temp_rec;
-      }
-    }
+    return flat.hit(r, t_min, t_max, rec);
+  }
 
-    if (bvh_root && bvh_root->hit(r, t_min, closest_so_far, temp_rec)) {
-      hit_anything = true;
-      rec = temp_rec;
-    }
+  bool hit_any(const ray &r, double t_min, double t_max,
+               const hittable *&occluder) const override {
+    return flat.hit_any(r, t_min, t_max, occluder);
+  }
 
-    return hit_anything;
+  // Testa apenas os objetos sem bounding box (fora da árvore).
+  bool hit_any_unbounded(const ray &r, double t_min, double t_max,
+                         const hittable *&occluder) const {
+    return flat.hit_any_unbounded(r, t_min, t_max, occluder);
   }
 
   std::string get_name() const override { return "BVH Scene"; }
@@ -162,6 +191,25 @@ public:
     }
     return false;
   }
+
+private:
+  // Os nós são numerados em pré-ordem, então o filho da esquerda fica logo
+  // depois do pai no vetor.
+  flat_scene::flat_child flatten_node(const hittable &obj) {
+    auto node = dynamic_cast<const bvh_node *>(&obj);
+    if (!node)
+      return flat.add_leaf(obj);
+
+    uint32_t index = flat.add_node(node->axis);
+    flat_scene::flat_child left = flatten_node(*node->left);
+    flat_scene::flat_child right =
+        node->right == node->left ? left : flatten_node(*node->right);
+    aabb left_box, right_box;
+    node->left->bounding_box(left_box);
+    node->right->bounding_box(right_box);
+    flat.set_children(index, left, left_box, right, right_box);
+    return {index, 0};
+  }
 };
 
 #endif
@@ -0,0 +1,516 @@
+#ifndef FLAT_SCENE_H
+#define FLAT_SCENE_H
+
+#include "../malha/mesh.h"
+#include "../malha/triangle.h"
+#include "../object/cone.h"
+#include "../object/cylinder.h"
+#include "../object/plane.h"
+#include "../object/sphere.h"
+#include "../render_stats.h"
+#include "aabb.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Cópia "achatada" da BVH usada no traçado dos raios. A árvore de bvh_node
+// continua sendo a fonte (montagem, snapshot, grade de sombras), mas o
+// percurso é feito aqui: nós num vetor contíguo, percorridos com uma pilha
+// fixa em vez de chamadas virtuais recursivas, e primitivas separadas por
+// tipo em arrays de parâmetros (estrutura de arrays), testadas por um switch
+// que chama as funções estáticas intersect() de cada classe.
+//
+// Malhas (box_mesh, blade_mesh) e hittable_list nas folhas são expandidas em
+// suas faces; o nome e o oclusor continuam sendo os do objeto original.
+// Tipos sem versão achatada (transform, por exemplo) ficam como referências
+// OBJECT e são testados pela interface virtual, como antes.
+//
+// O inverso da direção do raio é calculado uma vez por percurso (ray_query,
+// em aabb.h), não uma vez por nó.
+//
+// Cada nó guarda as caixas dos dois filhos: o pai testa as duas, empilha
+// primeiro o filho mais distante e guarda na pilha a distância de entrada de
+// cada um. Assim o filho mais próximo é percorrido antes, e um filho que o
+// raio só alcança depois do acerto mais próximo achado nesse meio-tempo é
+// descartado ao sair da pilha, sem ler o nó. Entre acertos à mesma
+// distância, vale o de quem foi testado primeiro. O registro do acerto
+// (hit_record) só é preenchido uma vez, para o mais próximo.
+class flat_scene {
+public:
+  enum class prim_type : uint32_t {
+    SPHERE,
+    CYLINDER,
+    CONE,
+    TRIANGLE,
+    PLANE,
+    OBJECT
+  };
+
+  struct prim_ref {
+    prim_type type;
+    uint32_t index; // posição no array do tipo
+  };
+
+  // Filho de um nó: com count == 0, 'first' é o índice de outro nó; caso
+  // contrário, é a faixa [first, first + count) de 'refs'.
+  struct flat_child {
+    uint32_t first;
+    uint32_t count;
+
+    bool is_node() const { return count == 0; }
+    bool operator==(const flat_child &o) const {
+      return first == o.first && count == o.count;
+    }
+  };
+
+  // 'axis' é o eixo em que a BVH ordenou os filhos (left com as coordenadas
+  // menores); desempata a ordem quando o raio entra nas duas caixas juntas.
+  struct flat_node {
+    aabb left_box, right_box;
+    flat_child left, right;
+    uint32_t axis;
+  };
+
+  void clear() { *this = flat_scene(); }
+
+  bool empty() const { return nodes.empty() && unbounded.empty(); }
+
+  // Montagem (bvh_scene::flatten). Os objetos precisam viver enquanto esta
+  // cópia for usada: só guardamos ponteiros para eles.
+  uint32_t add_node(int axis) {
+    nodes.push_back({aabb(), aabb(), {0, 0}, {0, 0},
+                     static_cast<uint32_t>(axis)});
+    return static_cast<uint32_t>(nodes.size() - 1);
+  }
+
+  void set_children(uint32_t node, flat_child left, const aabb &left_box,
+                    flat_child right, const aabb &right_box) {
+    nodes[node].left = left;
+    nodes[node].left_box = left_box;
+    nodes[node].right = right;
+    nodes[node].right_box = right_box;
+  }
+
+  void set_root(flat_child child, const aabb &box) {
+    root = child;
+    root_box = box;
+  }
+
+  flat_child add_leaf(const hittable &obj) {
+    uint32_t first = static_cast<uint32_t>(refs.size());
+    add_refs(obj, obj, refs);
+    if (refs.size() == first)
+      refs.push_back(add_object(obj));
+    return {first, static_cast<uint32_t>(refs.size() - first)};
+  }
+
+  void add_unbounded(const hittable &obj) { add_refs(obj, obj, unbounded); }
+
+  size_t node_count() const { return nodes.size(); }
+  size_t ref_count() const { return refs.size() + unbounded.size(); }
+
+  bool hit(const ray &r, double t_min, double t_max, hit_record &rec) const {
+    closest_hit best;
+    best.t = t_max;
+
+    for (const prim_ref &ref : unbounded)
+      test_closest(ref, r, t_min, best);
+
+    if (!nodes.empty()) {
+      ray_query q(r);
+      stack_entry stack[STACK_SIZE];
+      int top = 0;
+      double t_entry;
+      RT_COUNT(node_visits);
+      if (root_box.hit(q, t_min, best.t, t_entry))
+        stack[top++] = {root, t_entry};
+      while (top > 0) {
+        stack_entry entry = stack[--top];
+        // A caixa foi empilhada antes de acertos que podem estar na frente.
+        if (entry.t_entry >= best.t)
+          continue;
+        flat_child item = entry.child;
+        if (!item.is_node()) {
+          for (uint32_t i = item.first; i < item.first + item.count; i++)
+            test_closest(refs[i], r, t_min, best);
+          continue;
+        }
+        push_children(nodes[item.first], q, t_min, best.t, stack, top);
+      }
+    }
+
+    if (!best.found)
+      return false;
+    fill_record(r, best, rec);
+    return true;
+  }
+
+  bool hit_any(const ray &r, double t_min, double t_max,
+               const hittable *&occluder) const {
+    if (hit_any_unbounded(r, t_min, t_max, occluder))
+      return true;
+    if (nodes.empty())
+      return false;
+
+    ray_query q(r);
+    stack_entry stack[STACK_SIZE];
+    int top = 0;
+    double t_entry;
+    RT_COUNT(node_visits);
+    if (root_box.hit(q, t_min, t_max, t_entry))
+      stack[top++] = {root, t_entry};
+    while (top > 0) {
+      flat_child item = stack[--top].child;
+      if (!item.is_node()) {
+        for (uint32_t i = item.first; i < item.first + item.count; i++)
+          if (test_any(refs[i], r, t_min, t_max, occluder))
+            return true;
+        continue;
+      }
+      push_children(nodes[item.first], q, t_min, t_max, stack, top);
+    }
+    return false;
+  }
+
+  bool hit_any_unbounded(const ray &r, double t_min, double t_max,
+                         const hittable *&occluder) const {
+    for (const prim_ref &ref : unbounded)
+      if (test_any(ref, r, t_min, t_max, occluder))
+        return true;
+    return false;
+  }
+
+private:
+  // Cada nível da árvore ocupa no máximo uma posição a mais na pilha (o
+  // filho mais distante); a BVH divide pela mediana, então a profundidade é
+  // cerca de log2 do número de objetos.
+  static const int STACK_SIZE = 64;
+
+  // Filho a percorrer e a distância em que o raio entra na caixa dele.
+  struct stack_entry {
+    flat_child child;
+    double t_entry;
+  };
+
+  struct vec3_column {
+    std::vector<double> x, y, z;
+
+    void push(const vec3 &v) {
+      x.push_back(v.x());
+      y.push_back(v.y());
+      z.push_back(v.z());
+    }
+    vec3 operator[](size_t i) const { return vec3(x[i], y[i], z[i]); }
+  };
+
+  // 'source' é a primitiva (para preencher o registro do acerto); 'owner' é
+  // o objeto que a árvore enxerga (a malha, no caso das faces).
+  template <typename T> struct sources {
+    std::vector<const T *> source;
+    std::vector<const hittable *> owner;
+
+    uint32_t push(const T *s, const hittable *o) {
+      source.push_back(s);
+      owner.push_back(o);
+      return static_cast<uint32_t>(source.size() - 1);
+    }
+  };
+
+  struct sphere_array : sources<sphere> {
+    vec3_column center;
+    std::vector<double> radius;
+  };
+
+  struct cylinder_array : sources<cylinder> {
+    vec3_column base, axis;
+    std::vector<double> radius, height;
+  };
+
+  struct cone_array : sources<cone> {
+    vec3_column apex, axis;
+    std::vector<double> cos_angle, tan_angle, height;
+  };
+
+  // Arestas já subtraídas (e1 = v1 - v0, e2 = v2 - v0).
+  struct triangle_array : sources<triangle> {
+    vec3_column v0, e1, e2;
+  };
+
+  struct plane_array : sources<plane> {
+    vec3_column point, normal;
+  };
+
+  // Melhor acerto até agora. O registro dos objetos OBJECT alterna entre
+  // dois buffers para não copiar hit_record a cada acerto mais próximo.
+  struct closest_hit {
+    bool found = false;
+    prim_ref ref;
+    double t, u = 0, v = 0;
+    vec3 normal;
+    hit_record object_rec[2];
+    int object_slot = 0;
+  };
+
+  std::vector<flat_node> nodes;
+  flat_child root = {0, 0};
+  aabb root_box;
+  std::vector<prim_ref> refs;
+  std::vector<prim_ref> unbounded;
+
+  sphere_array spheres;
+  cylinder_array cylinders;
+  cone_array cones;
+  triangle_array triangles;
+  plane_array planes;
+  std::vector<const hittable *> objects;
+
+  prim_ref add_object(const hittable &obj) {
+    objects.push_back(&obj);
+    return {prim_type::OBJECT, static_cast<uint32_t>(objects.size() - 1)};
+  }
+
+  void add_refs(const hittable &obj, const hittable &owner,
+                std::vector<prim_ref> &out) {
+    if (auto s = dynamic_cast<const sphere *>(&obj)) {
+      uint32_t i = spheres.push(s, &owner);
+      spheres.center.push(s->center);
+      spheres.radius.push_back(s->radius);
+      out.push_back({prim_type::SPHERE, i});
+    } else if (auto c = dynamic_cast<const cylinder *>(&obj)) {
+      uint32_t i = cylinders.push(c, &owner);
+      cylinders.base.push(c->base_center);
+      cylinders.axis.push(c->axis);
+      cylinders.radius.push_back(c->radius);
+      cylinders.height.push_back(c->height);
+      out.push_back({prim_type::CYLINDER, i});
+    } else if (auto c = dynamic_cast<const cone *>(&obj)) {
+      uint32_t i = cones.push(c, &owner);
+      cones.apex.push(c->apex);
+      cones.axis.push(c->axis);
+      cones.cos_angle.push_back(std::cos(c->angle));
+      cones.tan_angle.push_back(std::tan(c->angle));
+      cones.height.push_back(c->height);
+      out.push_back({prim_type::CONE, i});
+    } else if (auto tri = dynamic_cast<const triangle *>(&obj)) {
+      uint32_t i = triangles.push(tri, &owner);
+      triangles.v0.push(tri->v0);
+      triangles.e1.push(tri->v1 - tri->v0);
+      triangles.e2.push(tri->v2 - tri->v0);
+      out.push_back({prim_type::TRIANGLE, i});
+    } else if (auto p = dynamic_cast<const plane *>(&obj)) {
+      uint32_t i = planes.push(p, &owner);
+      planes.point.push(p->point);
+      planes.normal.push(p->normal);
+      out.push_back({prim_type::PLANE, i});
+    } else if (auto m = dynamic_cast<const box_mesh *>(&obj)) {
+      for (const auto &face : m->faces.objects)
+        add_refs(*face, owner, out);
+    } else if (auto m = dynamic_cast<const blade_mesh *>(&obj)) {
+      for (const auto &face : m->faces.objects)
+        add_refs(*face, owner, out);
+    } else if (auto list = dynamic_cast<const hittable_list *>(&obj)) {
+      // A lista não dá nome ao acerto: cada membro é dono de si mesmo.
+      for (const auto &member : list->objects)
+        add_refs(*member, *member, out);
+    } else {
+      out.push_back(add_object(obj));
+    }
+  }
+
+  // Empilha os filhos de 'node' cuja caixa o raio cruza antes de t_max, o
+  // mais próximo por cima. Com as entradas empatadas (origem dentro das duas
+  // caixas), o sentido do raio no eixo da divisão decide.
+  void push_children(const flat_node &node, const ray_query &q, double t_min,
+                     double t_max, stack_entry *stack, int &top) const {
+    double t_left, t_right;
+    RT_COUNT(node_visits);
+    bool hit_left = node.left_box.hit(q, t_min, t_max, t_left);
+    // Nós com um único objeto repetem o filho; basta testá-lo uma vez.
+    bool hit_right = false;
+    if (!(node.right == node.left)) {
+      RT_COUNT(node_visits);
+      hit_right = node.right_box.hit(q, t_min, t_max, t_right);
+    }
+
+    if (hit_left && hit_right) {
+      bool right_first =
+          t_right < t_left || (t_right == t_left && q.sign[node.axis]);
+      if (right_first) {
+        stack[top++] = {node.left, t_left};
+        stack[top++] = {node.right, t_right};
+      } else {
+        stack[top++] = {node.right, t_right};
+        stack[top++] = {node.left, t_left};
+      }
+    } else if (hit_left) {
+      stack[top++] = {node.left, t_left};
+    } else if (hit_right) {
+      stack[top++] = {node.right, t_right};
+    }
+  }
+
+  // Testa uma referência contra o acerto mais próximo até agora.
+  void test_closest(const prim_ref &ref, const ray &r, double t_min,
+                    closest_hit &best) const {
+    uint32_t i = ref.index;
+    double t;
+    bool hit = false;
+
+    switch (ref.type) {
+    case prim_type::SPHERE:
+      RT_COUNT(primitive_tests);
+      hit = sphere::intersect(spheres.center[i], spheres.radius[i], r, t_min,
+                              best.t, t);
+      break;
+    case prim_type::CYLINDER: {
+      RT_COUNT(primitive_tests);
+      vec3 normal;
+      hit = cylinder::intersect(cylinders.base[i], cylinders.axis[i],
+                                cylinders.radius[i], cylinders.height[i], r,
+                                t_min, best.t, t, normal);
+      if (hit)
+        best.normal = normal;
+      break;
+    }
+    case prim_type::CONE: {
+      RT_COUNT(primitive_tests);
+      vec3 normal;
+      hit = cone::intersect(cones.apex[i], cones.axis[i], cones.cos_angle[i],
+                            cones.tan_angle[i], cones.height[i], r, t_min,
+                            best.t, t, normal);
+      if (hit)
+        best.normal = normal;
+      break;
+    }
+    case prim_type::TRIANGLE: {
+      RT_COUNT(primitive_tests);
+      RT_COUNT(triangle_tests);
+      double u, v;
+      hit = triangle::intersect(triangles.v0[i], triangles.e1[i],
+                                triangles.e2[i], r, t_min, best.t, t, u, v);
+      if (hit) {
+        best.u = u;
+        best.v = v;
+      }
+      break;
+    }
+    case prim_type::PLANE:
+      RT_COUNT(primitive_tests);
+      hit = plane::intersect(planes.point[i], planes.normal[i], r, t_min,
+                             best.t, t);
+      break;
+    case prim_type::OBJECT: {
+      int slot = best.object_slot ^ 1;
+      hit = objects[i]->hit(r, t_min, best.t, best.object_rec[slot]);
+      if (hit) {
+        best.object_slot = slot;
+        t = best.object_rec[slot].t;
+      }
+      break;
+    }
+    }
+
+    if (hit) {
+      best.found = true;
+      best.ref = ref;
+      best.t = t;
+    }
+  }
+
+  bool test_any(const prim_ref &ref, const ray &r, double t_min, double t_max,
+                const hittable *&occluder) const {
+    uint32_t i = ref.index;
+    double t;
+
+    switch (ref.type) {
+    case prim_type::SPHERE:
+      RT_COUNT(primitive_tests);
+      if (!sphere::intersect(spheres.center[i], spheres.radius[i], r, t_min,
+                             t_max, t))
+        return false;
+      occluder = spheres.owner[i];
+      return true;
+    case prim_type::CYLINDER: {
+      RT_COUNT(primitive_tests);
+      vec3 normal;
+      if (!cylinder::intersect(cylinders.base[i], cylinders.axis[i],
+                               cylinders.radius[i], cylinders.height[i], r,
+                               t_min, t_max, t, normal))
+        return false;
+      occluder = cylinders.owner[i];
+      return true;
+    }
+    case prim_type::CONE: {
+      RT_COUNT(primitive_tests);
+      vec3 normal;
+      if (!cone::intersect(cones.apex[i], cones.axis[i], cones.cos_angle[i],
+                           cones.tan_angle[i], cones.height[i], r, t_min,
+                           t_max, t, normal))
+        return false;
+      occluder = cones.owner[i];
+      return true;
+    }
+    case prim_type::TRIANGLE: {
+      RT_COUNT(primitive_tests);
+      RT_COUNT(triangle_tests);
+      double u, v;
+      if (!triangle::intersect(triangles.v0[i], triangles.e1[i],
+                               triangles.e2[i], r, t_min, t_max, t, u, v))
+        return false;
+      occluder = triangles.owner[i];
+      return true;
+    }
+    case prim_type::PLANE:
+      RT_COUNT(primitive_tests);
+      if (!plane::intersect(planes.point[i], planes.normal[i], r, t_min, t_max,
+                            t))
+        return false;
+      occluder = planes.owner[i];
+      return true;
+    case prim_type::OBJECT:
+      return objects[i]->hit_any(r, t_min, t_max, occluder);
+    }
+    return false;
+  }
+
+  template <typename T>
+  static void name_from_owner(const sources<T> &array, uint32_t i,
+                              hit_record &rec) {
+    if (array.owner[i] != array.source[i])
+      rec.object_name = array.owner[i]->get_name();
+  }
+
+  void fill_record(const ray &r, closest_hit &best, hit_record &rec) const {
+    uint32_t i = best.ref.index;
+    switch (best.ref.type) {
+    case prim_type::SPHERE:
+      spheres.source[i]->fill_record(r, best.t, rec);
+      name_from_owner(spheres, i, rec);
+      break;
+    case prim_type::CYLINDER:
+      cylinders.source[i]->fill_record(r, best.t, best.normal, rec);
+      name_from_owner(cylinders, i, rec);
+      break;
+    case prim_type::CONE:
+      cones.source[i]->fill_record(r, best.t, best.normal, rec);
+      name_from_owner(cones, i, rec);
+      break;
+    case prim_type::TRIANGLE:
+      triangles.source[i]->fill_record(r, best.t, best.u, best.v, rec);
+      name_from_owner(triangles, i, rec);
+      break;
+    case prim_type::PLANE:
+      planes.source[i]->fill_record(r, best.t, rec);
+      name_from_owner(planes, i, rec);
+      break;
+    case prim_type::OBJECT:
+      rec = std::move(best.object_rec[best.object_slot]);
+      break;
+    }
+  }
+};
+
+#endif
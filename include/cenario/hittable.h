@@ -14,6 +14,9 @@ struct hit_record {
   std::shared_ptr<material> mat;
   double t;
   double u, v;
+  // Variação de (u, v) por unidade de mundo no ponto atingido (0 se
+  // desconhecida). Usada para escolher o nível de mipmap das texturas.
+  double uv_scale = 0.0;
   bool front_face;
   std::string object_name;
 
@@ -36,6 +39,20 @@ public:
   virtual std::string get_name() const = 0;
 
   virtual bool bounding_box(aabb &output_box) const = 0;
+
+  // Consulta de oclusão (raios de sombra): basta saber se existe alguma
+  // interseção em [t_min, t_max], não a mais próxima. 'occluder' recebe o
+  // objeto folha que bloqueou o raio, para que o chamador possa testá-lo
+  // primeiro nos próximos raios (cache de oclusor).
+  virtual bool hit_any(const ray &r, double t_min, double t_max,
+                       const hittable *&occluder) const {
+    hit_record temp_rec;
+    if (hit(r, t_min, t_max, temp_rec)) {
+      occluder = this;
+      return true;
+    }
+    return false;
+  }
 };
 
 #endif
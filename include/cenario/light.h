@@ -19,10 +19,15 @@ public:
   // Se <= 0, é tratado como infinito / ignorado.
   double reach;
 
+  // Luzes fixas do cenário (setup_lighting). Permite pré-calcular a
+  // visibilidade de sombra delas sobre a geometria estática.
+  bool is_static;
+
   light(std::string n = "Light")
-      : intensity(1, 1, 1), name(n), enabled(true), reach(-1.0) {}
+      : intensity(1, 1, 1), name(n), enabled(true), reach(-1.0),
+        is_static(false) {}
   light(const color &i, std::string n = "Light")
-      : intensity(i), name(n), enabled(true), reach(-1.0) {}
+      : intensity(i), name(n), enabled(true), reach(-1.0), is_static(false) {}
 
   virtual ~light() = default;
   virtual vec3 get_direction(const point3 &point) const = 0;
@@ -29,6 +29,10 @@ extern int vanishing_points_preset;
 extern bool need_redraw;
 extern std::string picked_object;
 
+// Arquivo .cena carregado com load_scene_file(); vazio para a cena embutida
+// de create_scene().
+extern std::string scene_file_path;
+
 extern bool is_night_mode;
 extern color sky_color_top;
 extern color sky_color_bottom;
@@ -72,6 +76,28 @@ extern bool frame_cached;
 
 #include "cenario/bvh_node.h"
 extern bvh_scene scene_bvh;
+// Incrementado a cada reconstrução da BVH; invalida caches que guardam
+// ponteiros para objetos da cena (ex: cache de oclusores de sombra).
+extern unsigned int scene_bvh_version;
 void build_scene_bvh();
+// Compõe as cadeias de transforms fixos do mundo (flatten_transforms.h);
+// chamada por build_scene_bvh().
+void flatten_static_transforms();
+
+// Grava a cena atual, já com a BVH construída, num snapshot binário e o
+// recarrega sem parsing nem construção da BVH (formato em scene_snapshot.h).
+// load_scene_snapshot() devolve false, sem tocar na cena atual, se o arquivo
+// não existe, não é um snapshot válido desta versão ou foi gravado a partir
+// de outra cena que não 'scene_path' (vazio = cena embutida) como ela está
+// agora; nesse caso monte a cena e grave o snapshot de novo.
+bool save_scene_snapshot(const std::string &path);
+bool load_scene_snapshot(const std::string &path,
+                         const std::string &scene_path);
+
+#include "cenario/shadow_grid.h"
+extern baked_shadow_visibility baked_shadows;
+
+#include "render_stats.h"
+extern heatmap_metric heatmap_mode;
 
 #endif
@@ -115,6 +115,7 @@ private:
   static void drawTransformTab();
   static void drawShearTab();
   static void drawLightingTab();
+  static void drawStatsTab();
   static void drawTabs();
 
   static bool handleObjectTabClick(int local_x, int local_y);
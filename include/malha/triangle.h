@@ -2,6 +2,7 @@
 #define TRIANGLE_H
 
 #include "../cenario/hittable.h"
+#include "../render_stats.h"
 #include "../vectors/vec3.h"
 #include <cmath>
 
@@ -9,6 +10,9 @@ class triangle : public hittable {
 public:
   point3 v0, v1, v2;
   vec3 normal;
+  // Variação máxima das coordenadas baricêntricas por unidade de comprimento
+  // (inverso da menor altura do triângulo), usada no mipmapping.
+  double uv_scale = 0.0;
   std::shared_ptr<material> mat;
   std::string name;
 
@@ -21,15 +25,19 @@ public:
     vec3 e1 = v1 - v0;
     vec3 e2 = v2 - v0;
     normal = unit_vector(cross(e1, e2));
+
+    double area2 = cross(e1, e2).length();
+    if (area2 > 0.0)
+      uv_scale = std::fmax(e1.length(), e2.length()) / area2;
   }
 
-  bool hit(const ray &r, double t_min, double t_max,
-           hit_record &rec) const override {
+  // Möller-Trumbore a partir de v0 e das arestas e1 = v1 - v0, e2 = v2 - v0;
+  // compartilhado com flat_scene.h, que guarda as arestas prontas.
+  static bool intersect(const point3 &v0, const vec3 &e1, const vec3 &e2,
+                        const ray &r, double t_min, double t_max, double &t,
+                        double &u, double &v) {
     const double EPSILON = 1e-8;
 
-    vec3 e1 = v1 - v0;
-    vec3 e2 = v2 - v0;
-
     vec3 h = cross(r.direction(), e2);
     double a = dot(e1, h);
 
@@ -39,25 +47,26 @@ public:
 
     double f = 1.0 / a;
     vec3 s = r.origin() - v0;
-    double u = f * dot(s, h);
+    u = f * dot(s, h);
 
     if (u < 0.0 || u > 1.0) {
       return false;
     }
 
     vec3 q = cross(s, e1);
-    double v = f * dot(r.direction(), q);
+    v = f * dot(r.direction(), q);
 
     if (v < 0.0 || u + v > 1.0) {
       return false;
     }
 
-    double t = f * dot(e2, q);
+    t = f * dot(e2, q);
 
-    if (t < t_min || t > t_max) {
-      return false;
-    }
+    return !(t < t_min || t > t_max);
+  }
 
+  void fill_record(const ray &r, double t, double u, double v,
+                   hit_record &rec) const {
     rec.t = t;
     rec.p = r.at(t);
     rec.set_face_normal(r, normal);
@@ -65,7 +74,17 @@ public:
     rec.object_name = name;
     rec.u = u;
     rec.v = v;
+    rec.uv_scale = uv_scale;
+  }
 
+  bool hit(const ray &r, double t_min, double t_max,
+           hit_record &rec) const override {
+    RT_COUNT(primitive_tests);
+    RT_COUNT(triangle_tests);
+    double t, u, v;
+    if (!intersect(v0, v1 - v0, v2 - v0, r, t_min, t_max, t, u, v))
+      return false;
+    fill_record(r, t, u, v, rec);
     return true;
   }
 
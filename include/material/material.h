@@ -13,6 +13,8 @@ public:
   double shininess;
   std::string name;
   color emission;
+  // Filtragem das texturas de imagem (mipmap + bilinear/trilinear).
+  texture_filter filter = texture_filter::NEAREST;
 
   // [Requisito 1.3.2] Materiais (Obrigatório: pelo menos 4 materiais distintos)
   // define propriedades como difusa (kd), ambiente (ka), especular (ks), brilho
@@ -46,27 +48,42 @@ public:
   color get_diffuse(double u, double v, const point3 &p) const {
     return kd->value(u, v, p);
   }
+
+  color get_diffuse(double u, double v, const point3 &p,
+                    texture_query q) const {
+    q.filter = filter;
+    return kd->sample(u, v, p, q);
+  }
 };
 
 namespace materials {
 
+// Materiais com textura de imagem usam mipmap com filtragem trilinear, o que
+// evita o serrilhado (e as faltas de cache) em amostras distantes.
+inline std::shared_ptr<material> trilinear(std::shared_ptr<material> m) {
+  m->filter = texture_filter::TRILINEAR;
+  return m;
+}
+
 // [Requisito 1.3.3] Textura (Obrigatório: pelo menos 1 textura aplicada)
 // Aplica a textura 'metal_lamina.jpg' ao material 'Sword Metal'.
 inline std::shared_ptr<material> sword_metal() {
   auto tex = std::make_shared<image_texture>("textures/metal_lamina.jpg");
-  return std::make_shared<material>(
-      tex, color(0.1, 0.1, 0.12), color(0.9, 0.9, 0.95), 128.0, "Sword Metal");
+  return trilinear(std::make_shared<material>(tex, color(0.1, 0.1, 0.12),
+                                              color(0.9, 0.9, 0.95), 128.0,
+                                              "Sword Metal"));
 }
 
 inline std::shared_ptr<material> stone() {
   auto tex = std::make_shared<image_texture>("textures/rochas.jpg");
-  return std::make_shared<material>(tex, color(0.15, 0.14, 0.12),
-                                    color(0.1, 0.1, 0.1), 8.0, "Stone");
+  return trilinear(std::make_shared<material>(tex, color(0.15, 0.14, 0.12),
+                                              color(0.1, 0.1, 0.1), 8.0,
+                                              "Stone"));
 }
 
 inline std::shared_ptr<material> leather() {
   auto tex = std::make_shared<image_texture>("textures/couro_cabo.jpg");
-  return std::make_shared<material>(tex, 0.15, 0.05, 4.0, "Leather");
+  return trilinear(std::make_shared<material>(tex, 0.15, 0.05, 4.0, "Leather"));
 }
 
 inline std::shared_ptr<material> ruby_gem() {
@@ -75,12 +92,12 @@ inline std::shared_ptr<material> ruby_gem() {
 
 inline std::shared_ptr<material> gold() {
   auto tex = std::make_shared<image_texture>("textures/guarda_espada.jpg");
-  return std::make_shared<material>(tex, 0.15, 0.8, 200.0, "Gold");
+  return trilinear(std::make_shared<material>(tex, 0.15, 0.8, 200.0, "Gold"));
 }
 
 inline std::shared_ptr<material> wood() {
   auto tex = std::make_shared<image_texture>("textures/madeira.jpg");
-  return std::make_shared<material>(tex, 0.2, 0.1, 10.0, "Wood");
+  return trilinear(std::make_shared<material>(tex, 0.2, 0.1, 10.0, "Wood"));
 }
 
 inline std::shared_ptr<material> floor() {
@@ -97,14 +114,15 @@ inline std::shared_ptr<material> wall() {
 inline std::shared_ptr<material> moss() {
   auto tex =
       std::make_shared<tiled_image_texture>("textures/chao_grama.jpg", 80.0);
-  return std::make_shared<material>(tex, 0.25, 0.05, 2.0, "Moss");
+  return trilinear(std::make_shared<material>(tex, 0.25, 0.05, 2.0, "Moss"));
 }
 
 inline std::shared_ptr<material> dark_stone() {
   auto tex = std::make_shared<image_texture>("textures/rochas.jpg");
 
-  return std::make_shared<material>(tex, color(0.05, 0.05, 0.05),
-                                    color(0.05, 0.05, 0.05), 4.0, "Cave Wall");
+  return trilinear(std::make_shared<material>(tex, color(0.05, 0.05, 0.05),
+                                              color(0.05, 0.05, 0.05), 4.0,
+                                              "Cave Wall"));
 }
 
 inline std::shared_ptr<material> water() {
@@ -124,17 +142,19 @@ inline std::shared_ptr<material> mushroom_stem() {
 
 inline std::shared_ptr<material> wall_stone() {
   auto tex = std::make_shared<image_texture>("textures/rocha das paredes.jpg");
-  return std::make_shared<material>(tex, 0.1, 0.1, 5.0, "Wall Stone");
+  return trilinear(
+      std::make_shared<material>(tex, 0.1, 0.1, 5.0, "Wall Stone"));
 }
 
 inline std::shared_ptr<material> leaves() {
   auto tex = std::make_shared<image_texture>("textures/Folhas.png");
-  return std::make_shared<material>(tex, 0.1, 0.05, 1.0, "Leaves");
+  return trilinear(std::make_shared<material>(tex, 0.1, 0.05, 1.0, "Leaves"));
 }
 
 inline std::shared_ptr<material> lake_rock() {
   auto tex = std::make_shared<image_texture>("textures/rochas_lago.jpg");
-  return std::make_shared<material>(tex, 0.2, 0.3, 10.0, "Lake Rock");
+  return trilinear(
+      std::make_shared<material>(tex, 0.2, 0.3, 10.0, "Lake Rock"));
 }
 } // namespace materials
 
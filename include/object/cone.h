@@ -2,6 +2,7 @@
 #define CONE_H
 
 #include "../cenario/hittable.h"
+#include "../render_stats.h"
 #include "../vectors/vec3.h"
 #include <algorithm>
 #include <cmath>
@@ -35,13 +36,15 @@ public:
     return c;
   }
 
-  bool hit(const ray &r, double t_min, double t_max,
-           hit_record &rec) const override {
+  // Teste sem efeitos colaterais (compartilhado com flat_scene.h), com o
+  // cosseno e a tangente do semiângulo já calculados.
+  static bool intersect(const point3 &apex, const vec3 &axis, double cos_a,
+                        double tan_a, double height, const ray &r,
+                        double t_min, double t_max, double &t, vec3 &normal) {
     double best_t = t_max + 1;
     vec3 best_normal;
     bool found = false;
 
-    double cos_a = std::cos(angle);
     double cos2_a = cos_a * cos_a;
 
     vec3 D = r.direction();
@@ -50,7 +53,8 @@ public:
     double D_dot_A = dot(D, axis);
     double CO_dot_A = dot(CO, axis);
 
-    double a = D_dot_A * D_dot_A - cos2_a;
+    // |D|² não é 1 dentro de um transform (o raio local não é normalizado).
+    double a = D_dot_A * D_dot_A - dot(D, D) * cos2_a;
     double b = 2.0 * (D_dot_A * CO_dot_A - dot(D, CO) * cos2_a);
     double c = CO_dot_A * CO_dot_A - dot(CO, CO) * cos2_a;
 
@@ -79,12 +83,6 @@ public:
             vec3 cp = p - apex;
             vec3 proj = h_point * axis;
             vec3 radial = cp - proj;
-            double tan_a = std::tan(angle);
-            best_normal =
-                unit_vector(radial - tan_a * h_point * unit_vector(radial));
-
-            best_normal =
-                unit_vector(cp - (1.0 + tan_a * tan_a) * h_point * axis);
             best_normal = unit_vector(unit_vector(radial) - tan_a * axis);
             found = true;
           }
@@ -93,8 +91,9 @@ public:
     }
 
     point3 base_center = apex + height * axis;
-    double base_radius = height * std::tan(angle);
-    double t_base = hit_base(r, base_center, base_radius, t_min, best_t);
+    double base_radius = height * tan_a;
+    double t_base =
+        hit_base(r, base_center, axis, base_radius, t_min, best_t);
     if (t_base >= t_min && t_base < best_t) {
       best_t = t_base;
       best_normal = axis;
@@ -104,27 +103,46 @@ public:
     if (!found || best_t > t_max) {
       return false;
     }
+    t = best_t;
+    normal = best_normal;
+    return true;
+  }
 
-    rec.t = best_t;
-    rec.p = r.at(best_t);
-    rec.set_face_normal(r, best_normal);
+  void fill_record(const ray &r, double t, const vec3 &normal,
+                   hit_record &rec) const {
+    rec.t = t;
+    rec.p = r.at(t);
+    rec.set_face_normal(r, normal);
     rec.mat = mat;
     rec.object_name = name;
 
+    double base_radius = height * std::tan(angle);
     vec3 cp = rec.p - apex;
     double h_point = dot(cp, axis);
     rec.v = h_point / height;
     vec3 radial = cp - h_point * axis;
     rec.u = std::atan2(radial.z(), radial.x()) / (2.0 * 3.14159265358979) + 0.5;
+    rec.uv_scale =
+        std::fmax(1.0 / height, 1.0 / (2.0 * 3.14159265358979 * base_radius));
+  }
 
+  bool hit(const ray &r, double t_min, double t_max,
+           hit_record &rec) const override {
+    RT_COUNT(primitive_tests);
+    double t;
+    vec3 normal;
+    if (!intersect(apex, axis, std::cos(angle), std::tan(angle), height, r,
+                   t_min, t_max, t, normal))
+      return false;
+    fill_record(r, t, normal, rec);
     return true;
   }
 
   std::string get_name() const override { return name; }
 
 private:
-  double hit_base(const ray &r, const point3 &center, double radius,
-                  double t_min, double t_max) const {
+  static double hit_base(const ray &r, const point3 &center, const vec3 &axis,
+                         double radius, double t_min, double t_max) {
     double denom = dot(r.direction(), axis);
 
     if (std::abs(denom) < 1e-8) {
@@ -2,6 +2,7 @@
 #define CYLINDER_H
 
 #include "../cenario/hittable.h"
+#include "../render_stats.h"
 #include "../vectors/vec3.h"
 #include <algorithm>
 #include <cmath>
@@ -22,8 +23,11 @@ public:
       : base_center(base), axis(unit_vector(ax)), radius(r), height(h), mat(m),
         name(obj_name) {}
 
-  bool hit(const ray &r, double t_min, double t_max,
-           hit_record &rec) const override {
+  // Teste sem efeitos colaterais (compartilhado com flat_scene.h). Devolve
+  // em 'normal' a normal externa da parte atingida (lateral ou tampa).
+  static bool intersect(const point3 &base_center, const vec3 &axis,
+                        double radius, double height, const ray &r,
+                        double t_min, double t_max, double &t, vec3 &normal) {
     double best_t = t_max + 1;
     vec3 best_normal;
     bool found = false;
@@ -62,7 +66,7 @@ public:
       }
     }
 
-    double t_base = hit_cap(r, base_center, -axis, t_min, best_t);
+    double t_base = hit_cap(r, base_center, -axis, radius, t_min, best_t);
     if (t_base >= t_min && t_base < best_t) {
       best_t = t_base;
       best_normal = -axis;
@@ -70,7 +74,7 @@ public:
     }
 
     point3 top_center = base_center + height * axis;
-    double t_top = hit_cap(r, top_center, axis, t_min, best_t);
+    double t_top = hit_cap(r, top_center, axis, radius, t_min, best_t);
     if (t_top >= t_min && t_top < best_t) {
       best_t = t_top;
       best_normal = axis;
@@ -80,10 +84,16 @@ public:
     if (!found || best_t > t_max) {
       return false;
     }
+    t = best_t;
+    normal = best_normal;
+    return true;
+  }
 
-    rec.t = best_t;
-    rec.p = r.at(best_t);
-    rec.set_face_normal(r, best_normal);
+  void fill_record(const ray &r, double t, const vec3 &normal,
+                   hit_record &rec) const {
+    rec.t = t;
+    rec.p = r.at(t);
+    rec.set_face_normal(r, normal);
     rec.mat = mat;
     rec.object_name = name;
 
@@ -93,15 +103,28 @@ public:
 
     vec3 radial = local - h_point * axis;
     rec.u = std::atan2(radial.z(), radial.x()) / (2.0 * 3.14159265358979) + 0.5;
+    rec.uv_scale =
+        std::fmax(1.0 / height, 1.0 / (2.0 * 3.14159265358979 * radius));
+  }
 
+  bool hit(const ray &r, double t_min, double t_max,
+           hit_record &rec) const override {
+    RT_COUNT(primitive_tests);
+    double t;
+    vec3 normal;
+    if (!intersect(base_center, axis, radius, height, r, t_min, t_max, t,
+                   normal))
+      return false;
+    fill_record(r, t, normal, rec);
     return true;
   }
 
   std::string get_name() const override { return name; }
 
 private:
-  double hit_cap(const ray &r, const point3 &cap_center, const vec3 &cap_normal,
-                 double t_min, double t_max) const {
+  static double hit_cap(const ray &r, const point3 &cap_center,
+                        const vec3 &cap_normal, double radius, double t_min,
+                        double t_max) {
     double denom = dot(r.direction(), cap_normal);
 
     if (std::abs(denom) < 1e-8) {
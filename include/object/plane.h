@@ -2,6 +2,7 @@
 #define PLANE_H
 
 #include "../cenario/hittable.h"
+#include "../render_stats.h"
 #include "../vectors/vec3.h"
 #include <cmath>
 
@@ -17,21 +18,21 @@ public:
         const std::string &obj_name = "Plane")
       : point(p), normal(unit_vector(n)), mat(m), name(obj_name) {}
 
-  bool hit(const ray &r, double t_min, double t_max,
-           hit_record &rec) const override {
-
+  // Teste sem efeitos colaterais (compartilhado com flat_scene.h).
+  static bool intersect(const point3 &point, const vec3 &normal, const ray &r,
+                        double t_min, double t_max, double &t) {
     double denom = dot(r.direction(), normal);
 
     if (std::abs(denom) < 1e-8) {
       return false;
     }
 
-    double t = dot(point - r.origin(), normal) / denom;
+    t = dot(point - r.origin(), normal) / denom;
 
-    if (t < t_min || t > t_max) {
-      return false;
-    }
+    return !(t < t_min || t > t_max);
+  }
 
+  void fill_record(const ray &r, double t, hit_record &rec) const {
     rec.t = t;
     rec.p = r.at(t);
     rec.set_face_normal(r, normal);
@@ -40,7 +41,16 @@ public:
 
     rec.u = rec.p.x() * 0.1;
     rec.v = rec.p.z() * 0.1;
+    rec.uv_scale = 0.1;
+  }
 
+  bool hit(const ray &r, double t_min, double t_max,
+           hit_record &rec) const override {
+    RT_COUNT(primitive_tests);
+    double t;
+    if (!intersect(point, normal, r, t_min, t_max, t))
+      return false;
+    fill_record(r, t, rec);
     return true;
   }
 
@@ -2,6 +2,7 @@
 #define SPHERE_H
 
 #include "../cenario/hittable.h"
+#include "../render_stats.h"
 #include "../vectors/vec3.h"
 #include <cmath>
 #include <string>
@@ -18,9 +19,10 @@ public:
          const std::string &obj_name = "Sphere")
       : center(c), radius(r), mat(m), name(obj_name) {}
 
-  bool hit(const ray &r, double t_min, double t_max,
-           hit_record &rec) const override {
-
+  // Teste sem efeitos colaterais, a partir só dos parâmetros. É o mesmo
+  // código usado pelo armazenamento por tipo da BVH (flat_scene.h).
+  static bool intersect(const point3 &center, double radius, const ray &r,
+                        double t_min, double t_max, double &t) {
     vec3 L = r.origin() - center;
 
     double a = dot(r.direction(), r.direction());
@@ -35,14 +37,18 @@ public:
 
     double sqrt_d = std::sqrt(discriminant);
 
-    double t = (-b - sqrt_d) / (2.0 * a);
+    t = (-b - sqrt_d) / (2.0 * a);
     if (t < t_min || t > t_max) {
       t = (-b + sqrt_d) / (2.0 * a);
       if (t < t_min || t > t_max) {
         return false;
       }
     }
+    return true;
+  }
 
+  // Preenche 'rec' para um acerto em 't' encontrado por intersect().
+  void fill_record(const ray &r, double t, hit_record &rec) const {
     rec.t = t;
     rec.p = r.at(t);
     vec3 outward_normal = (rec.p - center) / radius;
@@ -55,7 +61,16 @@ public:
         std::atan2(-outward_normal.z(), outward_normal.x()) + 3.14159265358979;
     rec.u = phi / (2.0 * 3.14159265358979);
     rec.v = theta / 3.14159265358979;
+    rec.uv_scale = 1.0 / (3.14159265358979 * radius);
+  }
 
+  bool hit(const ray &r, double t_min, double t_max,
+           hit_record &rec) const override {
+    RT_COUNT(primitive_tests);
+    double t;
+    if (!intersect(center, radius, r, t_min, t_max, t))
+      return false;
+    fill_record(r, t, rec);
     return true;
   }
 
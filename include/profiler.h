@@ -0,0 +1,95 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+
+// Instrumentação leve por escopo (cronômetro RAII).
+//
+//   void build_scene_bvh() {
+//     PROFILE_SCOPE("build_scene_bvh");
+//     ...
+//   }
+//
+// Cada escopo vira um evento (nome, thread, início, duração). Os eventos
+// podem ser impressos como uma árvore (profiler::report) ou gravados no
+// formato de trace do Chrome (chrome://tracing, Perfetto).
+//
+// Os escopos da inicialização são sempre registrados. Os de cada quadro
+// (TRACE_SCOPE) só quando a captura está ligada, pois um quadro gera um
+// evento por linha de cada thread do OpenMP.
+namespace profiler {
+
+double now_us();
+
+void record(const std::string &name, double start_us, double end_us,
+            int depth, const std::string &args = "");
+
+class scope {
+public:
+  explicit scope(const std::string &name);
+  ~scope() { finish(); }
+
+  scope(const scope &) = delete;
+  scope &operator=(const scope &) = delete;
+
+  // Encerra o escopo antes do fim do bloco (trechos sequenciais de uma
+  // função longa, cujas variáveis precisam continuar visíveis).
+  void finish();
+
+private:
+  std::string name;
+  double start_us;
+  int depth;
+  bool open;
+};
+
+// Escopo registrado apenas com a captura ligada. Desligado, custa uma leitura
+// atômica. arg() anexa valores ao evento (campo "args" do trace).
+class trace_scope {
+public:
+  explicit trace_scope(const char *name);
+  ~trace_scope() { finish(); }
+
+  trace_scope(const trace_scope &) = delete;
+  trace_scope &operator=(const trace_scope &) = delete;
+
+  bool active() const { return open; }
+  void arg(const char *key, double value);
+  void finish();
+
+private:
+  const char *name;
+  double start_us = 0.0;
+  int depth = 0;
+  bool open;
+  std::string args;
+};
+
+bool capturing();
+void set_capture(bool on);
+
+// Amostra de um contador (trilha "C" no trace), ex.: raios de sombra por
+// quadro. Só registrada com a captura ligada.
+void counter(const std::string &name, double value);
+
+// Nome da thread atual no relatório e no trace.
+void set_thread_name(const std::string &name);
+
+// Árvore agregada (tempo total, chamadas e % do pai) de todos os eventos
+// registrados até agora, por thread.
+void report(const std::string &title);
+
+bool write_chrome_trace(const std::string &path);
+
+void clear();
+
+} // namespace profiler
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name)                                                    \
+  profiler::scope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define TRACE_SCOPE(name)                                                      \
+  profiler::trace_scope PROFILE_CONCAT(trace_scope_, __LINE__)(name)
+
+#endif
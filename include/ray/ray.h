@@ -12,6 +12,15 @@ public:
   ray(const point3 &origin, const vec3 &direction)
       : orig(origin), dir(unit_vector(direction)) {}
 
+  // Raio com a direção como dada, sem normalizar. transform::hit leva o raio
+  // ao espaço local assim, para que o parâmetro t valha nos dois espaços.
+  static ray unnormalized(const point3 &origin, const vec3 &direction) {
+    ray r;
+    r.orig = origin;
+    r.dir = direction;
+    return r;
+  }
+
   point3 origin() const { return orig; }
   vec3 direction() const { return dir; }
 
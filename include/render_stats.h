@@ -0,0 +1,72 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+// Contadores de custo do traçado de raios, acumulados por thread.
+//
+// A BVH, as primitivas, as texturas e os raios de sombra (cache de oclusores,
+// grade pré-calculada) incrementam os contadores da thread atual com
+// RT_COUNT(campo); o renderizador lê a diferença antes/depois de
+// cada pixel (mapa de calor) e soma os contadores das threads ao fim do
+// quadro. Compilar com -DRT_NO_STATS remove todos os incrementos.
+struct ray_cost_counters {
+  long long primary_rays = 0;
+  long long node_visits = 0;     // caixas da BVH testadas
+  long long primitive_tests = 0; // testes de interseção com primitivas
+  long long triangle_tests = 0;  // parte de primitive_tests
+  long long shadow_rays = 0;
+  long long occluded_shadow_rays = 0;
+  long long shadow_cache_tries = 0; // raios testados contra o último oclusor
+  long long shadow_cache_hits = 0;  // ... e bloqueados por ele
+  long long baked_shadow_rays = 0;  // resolvidos pela grade pré-calculada
+  long long texture_samples = 0;    // consultas a texturas de imagem
+
+  ray_cost_counters &operator+=(const ray_cost_counters &o) {
+    primary_rays += o.primary_rays;
+    node_visits += o.node_visits;
+    primitive_tests += o.primitive_tests;
+    triangle_tests += o.triangle_tests;
+    shadow_rays += o.shadow_rays;
+    occluded_shadow_rays += o.occluded_shadow_rays;
+    shadow_cache_tries += o.shadow_cache_tries;
+    shadow_cache_hits += o.shadow_cache_hits;
+    baked_shadow_rays += o.baked_shadow_rays;
+    texture_samples += o.texture_samples;
+    return *this;
+  }
+};
+
+// Totais do último quadro renderizado (render() ou render_preview()).
+struct render_frame_stats {
+  ray_cost_counters rays;
+  double frame_ms = 0.0;
+  bool preview = false;
+  int width = 0;
+  int height = 0;
+
+  long long total_rays() const { return rays.primary_rays + rays.shadow_rays; }
+
+  double rays_per_second() const {
+    return frame_ms > 0.0 ? total_rays() / (frame_ms / 1000.0) : 0.0;
+  }
+
+  double occluded_fraction() const {
+    return rays.shadow_rays > 0
+               ? double(rays.occluded_shadow_rays) / rays.shadow_rays
+               : 0.0;
+  }
+};
+
+// Métrica exibida no mapa de calor por pixel (tecla M).
+enum class heatmap_metric { OFF, NODE_VISITS, PRIMITIVE_TESTS, SHADOW_RAYS };
+
+namespace render_stats {
+inline thread_local ray_cost_counters local;
+} // namespace render_stats
+
+#ifdef RT_NO_STATS
+#define RT_COUNT(field) ((void)0)
+#else
+#define RT_COUNT(field) (++render_stats::local.field)
+#endif
+
+#endif
@@ -4,6 +4,7 @@
 #include "../include/cenario/hittable_list.h"
 #include "../include/colors/color.h"
 #include "../include/ray/ray.h"
+#include "../include/render_stats.h"
 
 color calculate_lighting(const hit_record &rec, const ray &r,
                          const hittable_list &world);
@@ -13,4 +14,10 @@ void render();
 void render_preview();
 void upscale_preview();
 
+const char *heatmap_metric_name(heatmap_metric m);
+
+// Contadores e tempo do último quadro (também usados no caminho headless).
+const render_frame_stats &last_frame_stats();
+void print_frame_stats(const render_frame_stats &s);
+
 #endif
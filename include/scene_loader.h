@@ -0,0 +1,64 @@
+#ifndef SCENE_LOADER_H
+#define SCENE_LOADER_H
+
+#include <string>
+
+// Carrega uma cena descrita em texto (.cena) no lugar de create_scene():
+// limpa o mundo, as luzes e o registro de objetos editáveis e os monta a
+// partir do arquivo. Devolve false (com a linha do erro no cerr) se o arquivo
+// não puder ser lido ou tiver um comando inválido. Como create_scene(),
+// configura a câmera mas não constrói a BVH: chame build_scene_bvh() depois.
+//
+// Formato: um comando por linha, '#' inicia comentário, nomes com espaços
+// vão entre aspas. Ângulos em graus. Um arquivo vazio é uma cena vazia.
+//
+//   camera  <olho xyz> <alvo xyz> <up xyz>
+//   ambient <rgb>
+//   sky     <rgb topo> <rgb horizonte>
+//
+//   texture <nome> image   "<arquivo>"
+//   texture <nome> tiled   "<arquivo>" <repetição>
+//   texture <nome> checker <rgb> <rgb> <escala>
+//   material <nome> (rgb <rgb> | tex <textura>) [ka <rgb>] [ks <rgb>]
+//            [ns <brilho>] [emission <rgb>] [filter nearest|bilinear|trilinear]
+//
+//   light point       "<nome>" pos <xyz> color <rgb> [att <c1 c2 c3>]
+//                     [reach <r>]
+//   light spot        "<nome>" pos <xyz> dir <xyz> color <rgb>
+//                     inner <graus> outer <graus> [att <c1 c2 c3>] [reach <r>]
+//   light directional "<nome>" dir <xyz> color <rgb>
+//
+//   sphere   <material> <centro xyz> <raio> ["nome"]
+//   cylinder <material> <base xyz> <eixo xyz> <raio> <altura> ["nome"]
+//   cone     <material> <base xyz> <eixo xyz> <raio da base> <altura> ["nome"]
+//   plane    <material> <ponto xyz> <normal xyz> ["nome"]
+//   triangle <material> <v0 xyz> <v1 xyz> <v2 xyz> ["nome"]
+//   box      <material> <mínimo xyz> <máximo xyz> ["nome"]
+//
+//   group ... end
+//   transform [translate <xyz>] [rotate_x|rotate_y|rotate_z <graus>]
+//             [scale <xyz>] [shear <xy xz yx yz zx zy>] ... end
+//   object "<nome>" pos <xyz> [rot <xyz>] [scale <xyz>] ... end
+//
+//   prototype <nome> ... end
+//   instance <protótipo> [operações de transform] [material <material>]
+//
+// As operações de 'transform' se compõem na ordem escrita (translate ...
+// rotate_y ... scale = T * Ry * S). 'object' só aparece no nível de cima e
+// registra o nó em object_states, como register_transformable.
+//
+// 'prototype' (também só no nível de cima) monta uma geometria sem pô-la no
+// mundo; cada 'instance' depois dela é um transform que a compartilha, com o
+// material trocado se 'material' for dado. Mil instâncias de uma árvore
+// custam mil matrizes, não mil cópias da árvore.
+//
+// Limitações: o formato cobre só parte do que create_scene() usa, e a cena
+// padrão não pode ser escrita nele. Faltam a malha da lâmina (blade_mesh),
+// rotação em torno de um eixo qualquer (rotate_axis_object, quatérnios) e
+// espelhamento (reflect_object). Também não há como marcar a luz da espada,
+// os vaga-lumes e tochas (sword_light_ptr, firefly_lights) nem o metal da
+// espada (mat_metal_ptr), que a troca dia/noite altera; por isso a tecla N
+// não muda a iluminação de uma cena carregada de arquivo.
+bool load_scene_file(const std::string &path);
+
+#endif
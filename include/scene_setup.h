@@ -1,12 +1,28 @@
 #ifndef SCENE_SETUP_H
 #define SCENE_SETUP_H
 
+#include "cenario/hittable.h"
+#include "transform/transform.h"
+#include "vectors/vec3.h"
+#include <memory>
 #include <string>
 
 void create_scene();
+// Identifica a compilação de create_scene() (data e hora em que
+// scene_setup.cpp foi compilado). Os snapshots da cena embutida guardam este
+// valor e deixam de valer quando ele muda.
+const char *builtin_scene_build_id();
 void setup_lighting();
 void setup_camera();
 
+// Envolve 'obj' num transform editável pela GUI (T * R * S) chamado 'name',
+// adiciona ao mundo e registra o estado inicial em object_states.
+std::shared_ptr<transform>
+register_transformable(std::shared_ptr<hittable> obj, const std::string &name,
+                       const vec3 &position,
+                       const vec3 &rotation = vec3(0, 0, 0),
+                       const vec3 &scale = vec3(1, 1, 1));
+
 void update_object_transform(const std::string &name);
 void update_sword_light();
 void toggle_blade_shine(bool increase);
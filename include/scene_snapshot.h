@@ -0,0 +1,34 @@
+#ifndef SCENE_SNAPSHOT_H
+#define SCENE_SNAPSHOT_H
+
+#include <string>
+
+// Snapshot binário da cena já construída: primitivas, materiais, texturas
+// (pelo caminho do arquivo), luzes, matrizes dos transforms, o registro de
+// objetos editáveis, a câmera e a BVH pronta. O arquivo é um cabeçalho
+// versionado seguido de tabelas de registros de tamanho fixo, alinhadas a 8
+// bytes; na leitura ele é mapeado em memória e as tabelas são percorridas no
+// próprio mapeamento, sem cópia nem parsing. Os objetos da cena são
+// recriados a partir dos registros, mas a BVH é religada nó a nó, sem
+// ordenar nem recalcular nenhuma bounding box.
+//
+// O formato depende da ordem de bytes e do layout de double da máquina que
+// gravou; arquivos de outra versão ou plataforma são recusados (read()
+// devolve false e a cena atual fica intacta).
+//
+// O cabeçalho guarda de onde a cena veio: o caminho do .cena com a data de
+// modificação e o tamanho dele, ou, para a cena embutida, a compilação de
+// create_scene() (builtin_scene_build_id()). read() recusa o snapshot se a
+// cena pedida for outra ou tiver mudado desde a gravação.
+//
+// Use pelas funções save_scene_snapshot() e load_scene_snapshot() de
+// globals.h, que também atualizam o estado derivado da BVH.
+namespace scene_snapshot {
+
+bool write(const std::string &path);
+// 'scene_path' é o .cena pedido, ou vazio para a cena embutida.
+bool read(const std::string &path, const std::string &scene_path);
+
+} // namespace scene_snapshot
+
+#endif
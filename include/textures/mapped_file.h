@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+
+// Arquivo mapeado em memória, somente leitura (mmap no POSIX,
+// CreateFileMapping no Windows). As páginas são carregadas pelo sistema sob
+// demanda, na primeira vez que forem lidas. Um arquivo vazio abre com
+// size() == 0 e data() nulo. Implementação em src/mapped_file.cpp, para não
+// expor os cabeçalhos do sistema.
+class mapped_file {
+public:
+  mapped_file() {}
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  ~mapped_file() { close(); }
+
+  bool open(const char *path);
+  void close();
+
+  const unsigned char *data() const {
+    return static_cast<const unsigned char *>(base);
+  }
+  size_t size() const { return bytes; }
+
+private:
+  void *base = nullptr;
+  size_t bytes = 0;
+  void *file_handle = nullptr;    // HANDLE (Windows)
+  void *mapping_handle = nullptr; // HANDLE (Windows)
+  int fd = -1;                    // descritor (POSIX)
+};
+
+#endif
@@ -2,18 +2,44 @@
 #define TEXTURE_H
 
 #include "../colors/color.h"
+#include "../render_stats.h"
 #include "../vectors/vec3.h"
-#include "stb_image.h"
+#include "mip_image.h"
+#include "texture_cache.h"
 #include "utils.h"
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <memory>
 
+// Dados do raio usados para filtrar texturas de imagem.
+struct texture_query {
+  // Largura, em unidades de mundo, da área coberta pelo pixel no ponto
+  // atingido (distância do olho * abertura do pixel, corrigida pela
+  // inclinação da superfície).
+  double footprint = 0.0;
+  // Variação de (u, v) por unidade de mundo (hit_record::uv_scale).
+  double uv_scale = 0.0;
+  texture_filter filter = texture_filter::NEAREST;
+
+  // Nível de mipmap para uma textura com 'texels_per_unit' texels do nível 0
+  // por unidade de mundo.
+  double lod(double texels_per_unit) const {
+    double texels = footprint * texels_per_unit;
+    return texels > 1.0 ? std::log2(texels) : 0.0;
+  }
+};
 
 class texture {
 public:
   virtual ~texture() = default;
   virtual color value(double u, double v, const point3 &p) const = 0;
+
+  // Amostragem filtrada. Texturas procedurais ignoram a consulta.
+  virtual color sample(double u, double v, const point3 &p,
+                       const texture_query &q) const {
+    return value(u, v, p);
+  }
 };
 
 class solid_color : public texture {
@@ -69,123 +95,88 @@ public:
   }
 };
 
+// A imagem decodificada vem do texture_cache e é compartilhada (somente
+// leitura) com as demais texturas que usam o mesmo arquivo. A decodificação
+// roda em segundo plano; a primeira amostragem espera por ela se preciso.
 class image_texture : public texture {
 private:
-  unsigned char *data;
-  int width, height;
-  int bytes_per_scanline;
+  texture_image_handle handle;
 
 public:
-  const static int bytes_per_pixel = 3;
-
-  image_texture(const char *filename) {
-    auto components_per_pixel = bytes_per_pixel;
-
-    data = stbi_load(filename, &width, &height, &components_per_pixel,
-                     components_per_pixel);
+  image_texture(const char *filename) : handle(filename) {}
 
-    if (!data) {
-      std::cerr << "ERROR: Could not load texture image file '" << filename
-                << "'.\n";
-
-      std::cerr << "Ensure stb_image.h is in include/ and file exists relative "
-                   "to executable.\n";
-      width = height = 0;
-    } else {
-      std::cout << "Loaded texture: " << filename << " (" << width << "x"
-                << height << ")\n";
-    }
-
-    bytes_per_scanline = bytes_per_pixel * width;
-  }
-
-  ~image_texture() {
-    if (data)
-      stbi_image_free(data);
-  }
+  const std::string &path() const { return handle.path(); }
 
   color value(double u, double v, const point3 &p) const override {
-
-    if (data == nullptr)
+    RT_COUNT(texture_samples);
+    const mip_image *image = handle.get();
+    if (!image)
       return color(1, 0, 1);
 
     u = clamp(u, 0.0, 1.0);
     v = 1.0 - clamp(v, 0.0, 1.0);
 
-    int i = static_cast<int>(u * width);
-    int j = static_cast<int>(v * height);
+    return image->nearest(0, u, v, texture_wrap::CLAMP);
+  }
 
-    if (i >= width)
-      i = width - 1;
-    if (j >= height)
-      j = height - 1;
+  color sample(double u, double v, const point3 &p,
+               const texture_query &q) const override {
+    const mip_image *image = handle.get();
+    if (!image || q.filter == texture_filter::NEAREST)
+      return value(u, v, p);
+    RT_COUNT(texture_samples);
 
-    const double color_scale = 1.0 / 255.0;
-    auto pixel = data + j * bytes_per_scanline + i * bytes_per_pixel;
+    // Texels do nível 0 cobertos pelo pixel: footprint (mundo) * uv_scale
+    // (uv por unidade de mundo) * resolução da imagem.
+    int size = std::max(image->width(), image->height());
+    double lod = q.lod(q.uv_scale * size);
 
-    return color(color_scale * pixel[0], color_scale * pixel[1],
-                 color_scale * pixel[2]);
+    u = clamp(u, 0.0, 1.0);
+    v = 1.0 - clamp(v, 0.0, 1.0);
+    return image->sample(u, v, lod, q.filter, texture_wrap::CLAMP);
   }
 };
 
 class tiled_image_texture : public texture {
 private:
-  unsigned char *data;
-  int width, height;
-  int bytes_per_scanline;
+  texture_image_handle handle;
   double scale;
 
 public:
-  const static int bytes_per_pixel = 3;
-
   tiled_image_texture(const char *filename, double tile_scale = 50.0)
-      : scale(tile_scale) {
-    auto components_per_pixel = bytes_per_pixel;
-
-    data = stbi_load(filename, &width, &height, &components_per_pixel,
-                     components_per_pixel);
-
-    if (!data) {
-      std::cerr << "ERROR: Could not load tiled texture '" << filename
-                << "'.\n";
-      width = height = 0;
-    } else {
-      std::cout << "Loaded tiled texture: " << filename << " (" << width << "x"
-                << height << ")\n";
-    }
-
-    bytes_per_scanline = bytes_per_pixel * width;
-  }
+      : handle(filename), scale(tile_scale) {}
 
-  ~tiled_image_texture() {
-    if (data)
-      stbi_image_free(data);
-  }
+  const std::string &path() const { return handle.path(); }
+  double tile_scale() const { return scale; }
 
   color value(double u, double v, const point3 &p) const override {
-    if (data == nullptr)
+    RT_COUNT(texture_samples);
+    const mip_image *image = handle.get();
+    if (!image)
       return color(1, 0, 1);
 
     double tile_u = std::fmod(std::abs(p.x() / scale), 1.0);
     double tile_v = std::fmod(std::abs(p.z() / scale), 1.0);
 
-    int i = static_cast<int>(tile_u * width);
-    int j = static_cast<int>((1.0 - tile_v) * height);
+    return image->nearest(0, tile_u, 1.0 - tile_v, texture_wrap::CLAMP);
+  }
 
-    if (i >= width)
-      i = width - 1;
-    if (j >= height)
-      j = height - 1;
-    if (i < 0)
-      i = 0;
-    if (j < 0)
-      j = 0;
+  // O ladrilho é mapeado direto do espaço de mundo (uma cópia da imagem a
+  // cada 'scale' unidades), então o LOD independe de uv_scale.
+  color sample(double u, double v, const point3 &p,
+               const texture_query &q) const override {
+    const mip_image *image = handle.get();
+    if (!image || q.filter == texture_filter::NEAREST)
+      return value(u, v, p);
+    RT_COUNT(texture_samples);
 
-    const double color_scale = 1.0 / 255.0;
-    auto pixel = data + j * bytes_per_scanline + i * bytes_per_pixel;
+    int size = std::max(image->width(), image->height());
+    double lod = q.lod(size / scale);
 
-    return color(color_scale * pixel[0], color_scale * pixel[1],
-                 color_scale * pixel[2]);
+    double tile_u = std::fmod(std::abs(p.x() / scale), 1.0);
+    double tile_v = std::fmod(std::abs(p.z() / scale), 1.0);
+    return image->sample(tile_u, 1.0 - tile_v, lod, q.filter,
+                         texture_wrap::REPEAT);
   }
 };
 
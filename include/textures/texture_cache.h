@@ -0,0 +1,340 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include "../profiler.h"
+#include "mip_image.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Cache de imagens decodificadas, único no processo.
+// Vários materiais usam o mesmo arquivo (stone() e dark_stone() carregam
+// "rochas.jpg") e create_scene() é chamada de novo ao reiniciar a cena. A
+// chave é o caminho mais as opções de decodificação; o valor é uma imagem
+// imutável compartilhada por todas as texturas que a usam.
+//
+// A decodificação é assíncrona: load_async() apenas enfileira o arquivo para
+// um pool de threads e devolve um shared_future. A construção da cena e da
+// BVH segue em paralelo; quem precisar dos texels espera pelo future.
+//
+// As imagens decodificadas (com os mipmaps) também são gravadas em
+// 'disk_cache_dir'. Nas execuções seguintes, se o arquivo de origem não
+// mudou (data e tamanho), o cache é mapeado em memória em vez de decodificar
+// o JPEG/PNG de novo.
+class texture_cache {
+public:
+  typedef std::shared_ptr<const mip_image> image_ptr;
+  typedef std::shared_future<image_ptr> pending_image;
+
+  bool use_disk_cache = true;
+  std::string disk_cache_dir = "textures/.cache";
+
+  struct stats {
+    int decoded = 0;
+    int mapped = 0; // lidas do cache em disco
+    int reused = 0;
+    int failed = 0;
+    int threads = 0;
+    double decode_ms = 0.0; // soma dos tempos de cada decodificação
+    double wall_ms = 0.0;   // do primeiro pedido até a fila esvaziar
+    size_t bytes_decoded = 0;
+    size_t bytes_saved = 0;
+  };
+
+  static texture_cache &instance() {
+    static texture_cache cache;
+    return cache;
+  }
+
+  ~texture_cache() {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      stopping = true;
+    }
+    work_ready.notify_all();
+    for (auto &w : workers)
+      w.join();
+  }
+
+  // Enfileira a decodificação (se o arquivo ainda não está no cache). O
+  // future resulta em nullptr se o arquivo não pôde ser lido.
+  pending_image load_async(const std::string &path, bool build_mips = true) {
+    key k(path, build_mips);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(k);
+    if (it != entries.end()) {
+      counters.reused++;
+      reused_keys.push_back(k);
+      if (queue.empty() && active == 0)
+        count_saved_bytes();
+      return it->second;
+    }
+
+    if (workers.empty())
+      start_workers();
+
+    auto result = std::make_shared<std::promise<image_ptr>>();
+    pending_image future = result->get_future().share();
+    entries[k] = future;
+    queue.push_back({k, result});
+    work_ready.notify_one();
+    return future;
+  }
+
+  image_ptr load(const std::string &path, bool build_mips = true) {
+    return load_async(path, build_mips).get();
+  }
+
+  // Bloqueia até que todas as decodificações pendentes terminem.
+  void wait_all() {
+    std::unique_lock<std::mutex> lock(mtx);
+    idle.wait(lock, [this] { return queue.empty() && active == 0; });
+  }
+
+  // Zera as estatísticas e marca o início de um lote de pedidos.
+  void reset_stats() {
+    std::lock_guard<std::mutex> lock(mtx);
+    counters = stats();
+    reused_keys.clear();
+    batch_start = std::chrono::steady_clock::now();
+  }
+
+  // Imprime o resumo do lote assim que a fila esvaziar (na hora, se já
+  // estiver vazia), sem bloquear quem chamou.
+  void report_when_idle() {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (!queue.empty() || active > 0) {
+      report_requested = true;
+      return;
+    }
+    count_saved_bytes();
+    lock.unlock();
+    report();
+  }
+
+  stats get_stats() {
+    std::lock_guard<std::mutex> lock(mtx);
+    stats s = counters;
+    s.threads = static_cast<int>(workers.size());
+    return s;
+  }
+
+  void report() {
+    stats s = get_stats();
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1) << "Texturas: " << s.decoded
+       << " decodificadas e " << s.mapped << " mapeadas do cache em disco em "
+       << s.wall_ms << " ms (" << s.decode_ms
+       << " ms somando " << s.threads << " threads, "
+       << s.bytes_decoded / (1024.0 * 1024.0) << " MB), " << s.reused
+       << " reaproveitadas do cache (" << s.bytes_saved / (1024.0 * 1024.0)
+       << " MB economizados)";
+    if (s.failed > 0)
+      ss << ", " << s.failed << " com erro";
+    std::cout << ss.str() << "\n";
+  }
+
+  // Data de modificação e tamanho de 'path' (também usados pelo snapshot de
+  // cena para saber se o .cena mudou). Retorna false se o arquivo não existe.
+  static bool stat_source(const std::string &path,
+                          mip_image::source_stamp &stamp) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec)
+      return false;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec)
+      return false;
+    stamp.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    stamp.size = static_cast<int64_t>(size);
+    return true;
+  }
+
+private:
+  typedef std::pair<std::string, bool> key;
+
+  struct job {
+    key k;
+    std::shared_ptr<std::promise<image_ptr>> result;
+  };
+
+  std::mutex mtx;
+  std::condition_variable work_ready;
+  std::condition_variable idle;
+  std::map<key, pending_image> entries;
+  std::deque<job> queue;
+  std::vector<std::thread> workers;
+  std::vector<key> reused_keys;
+  int active = 0;
+  bool stopping = false;
+  bool report_requested = false;
+  std::chrono::steady_clock::time_point batch_start;
+  stats counters;
+
+  texture_cache() {}
+
+  // Nome do arquivo de cache: hash FNV-1a do caminho e das opções.
+  std::string disk_cache_path(const key &k) const {
+    uint64_t hash = 1469598103934665603ull;
+    std::string id = k.first + (k.second ? "|mips" : "|nomips");
+    for (unsigned char c : id) {
+      hash ^= c;
+      hash *= 1099511628211ull;
+    }
+    std::stringstream name;
+    name << disk_cache_dir << "/" << std::hex << std::setw(16)
+         << std::setfill('0') << hash << ".mip";
+    return name.str();
+  }
+
+  // Lê a imagem do cache em disco ou, se não houver cache válido, decodifica
+  // e grava o cache. Executado pelas threads do pool, sem o mutex.
+  std::shared_ptr<mip_image> load_image(const key &k, bool &from_disk) {
+    PROFILE_SCOPE("textura " + k.first);
+    auto image = std::make_shared<mip_image>();
+    from_disk = false;
+
+    mip_image::source_stamp stamp;
+    bool cacheable = use_disk_cache && stat_source(k.first, stamp);
+    std::string cache_path = cacheable ? disk_cache_path(k) : "";
+
+    if (cacheable && image->load_cache(cache_path, k.first, stamp, k.second)) {
+      from_disk = true;
+      return image;
+    }
+
+    if (!image->load(k.first.c_str(), k.second))
+      return nullptr;
+
+    if (cacheable) {
+      std::error_code ec;
+      std::filesystem::create_directories(disk_cache_dir, ec);
+      if (ec || !image->save_cache(cache_path, k.first, stamp, k.second))
+        std::cerr << "Aviso: nao foi possivel gravar o cache de textura '"
+                  << cache_path << "'\n";
+    }
+    return image;
+  }
+
+  void start_workers() {
+    int n = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < n; i++)
+      workers.emplace_back([this] { worker_loop(); });
+  }
+
+  // O tamanho de uma imagem reaproveitada só é conhecido depois que ela foi
+  // decodificada; chamado com o mutex travado e a fila vazia.
+  void count_saved_bytes() {
+    for (const auto &k : reused_keys) {
+      const image_ptr &image = entries[k].get();
+      if (image)
+        counters.bytes_saved += image->memory_bytes();
+    }
+    reused_keys.clear();
+  }
+
+  void worker_loop() {
+    profiler::set_thread_name("decodificador de texturas");
+    std::unique_lock<std::mutex> lock(mtx);
+    for (;;) {
+      work_ready.wait(lock, [this] { return stopping || !queue.empty(); });
+      if (queue.empty())
+        return;
+
+      job j = queue.front();
+      queue.pop_front();
+      active++;
+      lock.unlock();
+
+      auto start = std::chrono::steady_clock::now();
+      bool from_disk = false;
+      std::shared_ptr<mip_image> image = load_image(j.k, from_disk);
+      auto end = std::chrono::steady_clock::now();
+
+      std::stringstream msg;
+      if (image) {
+        msg << "Loaded texture: " << j.k.first << " (" << image->width()
+            << "x" << image->height() << ", " << image->level_count()
+            << " mips" << (from_disk ? ", cache em disco" : "") << ")\n";
+        std::cout << msg.str();
+      } else {
+        msg << "ERROR: Could not load texture image file '" << j.k.first
+            << "'.\nEnsure stb_image.h is in include/ and file exists "
+               "relative to executable.\n";
+        std::cerr << msg.str();
+      }
+
+      j.result->set_value(image);
+
+      lock.lock();
+      active--;
+      if (image) {
+        (from_disk ? counters.mapped : counters.decoded)++;
+        counters.bytes_decoded += image->memory_bytes();
+        counters.decode_ms +=
+            std::chrono::duration<double, std::milli>(end - start).count();
+      } else {
+        counters.failed++;
+      }
+
+      if (queue.empty() && active == 0) {
+        counters.wall_ms =
+            std::chrono::duration<double, std::milli>(end - batch_start)
+                .count();
+        count_saved_bytes();
+        idle.notify_all();
+
+        if (report_requested) {
+          report_requested = false;
+          lock.unlock();
+          report();
+          lock.lock();
+        }
+      }
+    }
+  }
+};
+
+// Imagem que pode ainda estar sendo decodificada. A primeira consulta
+// espera pelo future; as seguintes leem apenas um ponteiro atômico.
+class texture_image_handle {
+public:
+  texture_image_handle(const char *filename)
+      : pending(texture_cache::instance().load_async(filename)),
+        source(filename) {}
+
+  // Arquivo de origem (usado ao gravar o snapshot da cena).
+  const std::string &path() const { return source; }
+
+  const mip_image *get() const {
+    if (!resolved.load(std::memory_order_acquire)) {
+      image.store(pending.get().get(), std::memory_order_relaxed);
+      resolved.store(true, std::memory_order_release);
+    }
+    return image.load(std::memory_order_relaxed);
+  }
+
+private:
+  texture_cache::pending_image pending;
+  std::string source;
+  mutable std::atomic<const mip_image *> image{nullptr};
+  mutable std::atomic<bool> resolved{false};
+};
+
+#endif
@@ -2,8 +2,8 @@
 #define UTILS_H
 
 #include <cmath>
+#include <cstdint>
 #include <limits>
-#include <random>
 
 
 const double infinity = std::numeric_limits<double>::infinity();
@@ -25,14 +25,78 @@ inline double clamp(double x, double low, double high) {
 }
 
 
+// Gerador baseado em contador: o n-ésimo número de um fluxo é
+// splitmix64(chave + n * gamma), sem estado além da chave e do contador.
+// Fluxos independentes saem de split() com um índice (pixel, amostra,
+// objeto) ou um nome, então cada parte da cena ou do renderizador tem o seu
+// gerador, reprodutível e sem nada compartilhado entre threads.
+class counter_rng {
+public:
+    explicit counter_rng(uint64_t seed = 0, uint64_t stream = 0)
+        : key(mix(seed ^ mix(stream + GAMMA))), counter(0) {}
+
+    // Fluxo filho; não consome números do pai.
+    counter_rng split(uint64_t stream) const {
+        return counter_rng(key, stream);
+    }
+    counter_rng split(const char *name) const { return split(hash_name(name)); }
+
+    // Gerador da amostra 'sample' do pixel (x, y).
+    static counter_rng for_pixel(uint64_t seed, uint32_t x, uint32_t y,
+                                 uint32_t sample) {
+        uint64_t pixel = (uint64_t(y) << 32) | x;
+        return counter_rng(seed, pixel).split(sample);
+    }
+
+    // Número de índice 'n' do fluxo, sem avançar o contador.
+    uint64_t at(uint64_t n) const { return mix(key + n * GAMMA); }
+
+    uint64_t next_u64() { return at(counter++); }
+
+    // Uniforme em [0, 1) com 53 bits de mantissa.
+    double next_double() {
+        return (next_u64() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    double uniform(double min, double max) {
+        return min + (max - min) * next_double();
+    }
+
+private:
+    static constexpr uint64_t GAMMA = 0x9e3779b97f4a7c15ull;
+
+    uint64_t key;
+    uint64_t counter;
+
+    // Finalizador do splitmix64.
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    // FNV-1a, para nomear fluxos com texto.
+    static uint64_t hash_name(const char *name) {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for (; *name; name++)
+            h = (h ^ static_cast<unsigned char>(*name)) * 0x100000001b3ull;
+        return h;
+    }
+};
+
+// Gerador de random_double(): um por thread, todos com a mesma semente.
+// Código novo deve preferir um counter_rng próprio com split().
+inline counter_rng &thread_rng() {
+    thread_local counter_rng rng(0x5eed);
+    return rng;
+}
+
 inline double random_double() {
-    static std::uniform_real_distribution<double> distribution(0.0, 1.0);
-    static std::mt19937 generator;
-    return distribution(generator);
+    return thread_rng().next_double();
 }
 
 inline double random_double(double min, double max) {
-    return min + (max - min) * random_double();
+    return thread_rng().uniform(min, max);
 }
 
 #endif
@@ -0,0 +1,249 @@
+#ifndef FLATTEN_TRANSFORMS_H
+#define FLATTEN_TRANSFORMS_H
+
+#include "../cenario/hittable_list.h"
+#include "../malha/mesh.h"
+#include "../malha/triangle.h"
+#include "../object/cone.h"
+#include "../object/cylinder.h"
+#include "../object/sphere.h"
+#include "../vectors/affine3x4.h"
+#include "transform.h"
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+// Passo de montagem que compõe cadeias de transforms fixos. Um objeto como
+// translate_object(cilindro) dentro de uma lista dentro de outro transform
+// custa, por raio, duas multiplicações 4x4 e uma renormalização por camada;
+// depois do passo, cada folha fica sob uma única matriz estática:
+//
+//   T(U(x))            ->  (T * U)(x)
+//   T(lista(U(a), b))  ->  lista((T * U)(a), T(b))
+//
+// Os transforms editáveis (object_transforms: objetos registrados, gemas da
+// espada) mudam em tempo de execução e são barreiras: continuam sendo nós,
+// e só o conteúdo deles é achatado (no próprio nó, para que os ponteiros
+// guardados em object_transforms continuem valendo).
+//
+// A matriz que sobra sobre uma folha simples é dobrada na geometria, e a
+// folha fica sem transform: esferas, cilindros e cones sob translação
+// ganham o centro deslocado; triângulos e caixas sob qualquer afim de
+// determinante positivo (um espelho inverteria a face) ganham os vértices
+// transformados. As coordenadas u, v dessas folhas não dependem da posição,
+// então só muda a escala de mip das malhas cisalhadas ou escaladas, agora
+// medida nos triângulos já transformados. É o caso das peças de uma lista
+// registrada (translate_object(cilindro) dentro de register_transformable)
+// e das asas dos pássaros (um cisalhamento sobre a lista wing_comp).
+//
+// O nome e o material_override do transform de fora prevalecem, como em
+// transform::hit. Subárvores compartilhadas (protótipos de instâncias) são
+// achatadas uma vez e continuam compartilhadas. Rodar o passo de novo sobre
+// uma cena já achatada não muda nada.
+class transform_flattener {
+public:
+  explicit transform_flattener(const std::set<const hittable *> &editable)
+      : editable(editable) {}
+
+  // Achata os objetos do mundo. No nível de cima um transform nunca vira
+  // lista, para que o objeto mantenha o nome (remove_by_name_prefix).
+  void run(std::vector<std::shared_ptr<hittable>> &objects) {
+    for (auto &obj : objects)
+      obj = flatten(obj, false);
+  }
+
+  // Camadas de transform eliminadas pela composição.
+  int composed_layers() const { return composed; }
+
+  // Folhas que receberam a matriz de cima na própria geometria.
+  int baked_leaves() const { return baked; }
+
+private:
+  const std::set<const hittable *> &editable;
+  std::map<const hittable *, std::shared_ptr<hittable>> done;
+  int composed = 0;
+  int baked = 0;
+
+  struct layer {
+    mat4 forward, inverse;
+    std::string name;
+    std::shared_ptr<material> material_override;
+  };
+
+  const transform *static_transform(const hittable *obj) const {
+    auto t = dynamic_cast<const transform *>(obj);
+    return t && !editable.count(t) ? t : nullptr;
+  }
+
+  // Só vale distribuir uma matriz por uma lista se algum filho for outro
+  // transform fixo (ou lista) com que ela possa ser composta, ou uma folha
+  // que a absorva.
+  bool worth_distributing(const layer &l, const hittable_list &list) const {
+    for (const auto &child : list.objects)
+      if (static_transform(child.get()) ||
+          dynamic_cast<const hittable_list *>(child.get()) ||
+          bakes(l, *child, true))
+        return true;
+    return false;
+  }
+
+  static bool is_translation(const mat4 &m) {
+    if (!affine3x4::is_affine(m))
+      return false;
+    for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 3; j++)
+        if (m.m[i][j] != (i == j ? 1.0 : 0.0))
+          return false;
+    return true;
+  }
+
+  static bool keeps_orientation(const mat4 &m) {
+    if (!affine3x4::is_affine(m))
+      return false;
+    double det = m.m[0][0] * (m.m[1][1] * m.m[2][2] - m.m[1][2] * m.m[2][1]) -
+                 m.m[0][1] * (m.m[1][0] * m.m[2][2] - m.m[1][2] * m.m[2][0]) +
+                 m.m[0][2] * (m.m[1][0] * m.m[2][1] - m.m[1][1] * m.m[2][0]);
+    return det > 0.0;
+  }
+
+  // Se bake() aceita 'obj' sob 'l'. Uma caixa fora dos eixos vira lista de
+  // triângulos, que no nível de cima perderia o nome: lá (in_list falso) a
+  // caixa só é dobrada sob translação.
+  bool bakes(const layer &l, const hittable &obj, bool in_list) const {
+    if (dynamic_cast<const sphere *>(&obj) ||
+        dynamic_cast<const cylinder *>(&obj) ||
+        dynamic_cast<const cone *>(&obj))
+      return is_translation(l.forward);
+    if (dynamic_cast<const triangle *>(&obj))
+      return keeps_orientation(l.forward);
+    if (dynamic_cast<const box_mesh *>(&obj))
+      return is_translation(l.forward) ||
+             (in_list && keeps_orientation(l.forward));
+    return false;
+  }
+
+  // Cópia de 'obj' com a camada dobrada; o nome e o material_override da
+  // camada ficam na folha, como transform::hit faria.
+  std::shared_ptr<hittable> bake(const layer &l,
+                                 const std::shared_ptr<hittable> &obj) {
+    baked++;
+    affine3x4 m(l.forward);
+    vec3 offset = m.c[3];
+    auto pick = [&](const std::shared_ptr<material> &own) {
+      return l.material_override ? l.material_override : own;
+    };
+
+    if (auto s = std::dynamic_pointer_cast<sphere>(obj)) {
+      return std::make_shared<sphere>(s->center + offset, s->radius,
+                                      pick(s->mat), l.name);
+    }
+    if (auto c = std::dynamic_pointer_cast<cylinder>(obj)) {
+      auto copy = std::make_shared<cylinder>(*c);
+      copy->base_center += offset;
+      copy->mat = pick(c->mat);
+      copy->name = l.name;
+      return copy;
+    }
+    if (auto c = std::dynamic_pointer_cast<cone>(obj)) {
+      auto copy = std::make_shared<cone>(*c);
+      copy->apex += offset;
+      copy->mat = pick(c->mat);
+      copy->name = l.name;
+      return copy;
+    }
+    if (auto t = std::dynamic_pointer_cast<triangle>(obj)) {
+      return std::make_shared<triangle>(m.apply_point(t->v0),
+                                        m.apply_point(t->v1),
+                                        m.apply_point(t->v2), pick(t->mat),
+                                        l.name);
+    }
+
+    auto box = std::dynamic_pointer_cast<box_mesh>(obj);
+    if (is_translation(l.forward)) {
+      return std::make_shared<box_mesh>(box->min_corner + offset,
+                                        box->max_corner + offset,
+                                        pick(box->mat), l.name);
+    }
+    auto faces = std::make_shared<hittable_list>();
+    for (const auto &face : box->faces.objects) {
+      auto t = std::static_pointer_cast<triangle>(face);
+      faces->add(std::make_shared<triangle>(
+          m.apply_point(t->v0), m.apply_point(t->v1), m.apply_point(t->v2),
+          pick(box->mat), l.name));
+    }
+    return faces;
+  }
+
+  std::shared_ptr<hittable> flatten(const std::shared_ptr<hittable> &obj,
+                                    bool distribute = true) {
+    auto it = done.find(obj.get());
+    if (it != done.end())
+      return it->second;
+
+    std::shared_ptr<hittable> result = obj;
+    if (auto list = std::dynamic_pointer_cast<hittable_list>(obj)) {
+      result = flatten_list(list);
+    } else if (auto t = std::dynamic_pointer_cast<transform>(obj)) {
+      if (editable.count(t.get()))
+        t->set_object(flatten(t->object));
+      else
+        result = push({t->forward, t->inverse, t->name, t->material_override},
+                      t->object, distribute, t);
+    }
+    done[obj.get()] = result;
+    return result;
+  }
+
+  std::shared_ptr<hittable>
+  flatten_list(const std::shared_ptr<hittable_list> &list) {
+    std::vector<std::shared_ptr<hittable>> children;
+    bool changed = false;
+    for (const auto &child : list->objects) {
+      children.push_back(flatten(child));
+      changed |= children.back() != child;
+    }
+    if (!changed)
+      return list;
+    auto copy = std::make_shared<hittable_list>();
+    copy->objects = std::move(children);
+    return copy;
+  }
+
+  // Aplica a camada 'l' (fixa) sobre 'child'. 'original' é o transform de
+  // onde a camada veio, devolvido sem cópia quando nada muda.
+  std::shared_ptr<hittable> push(const layer &l,
+                                 const std::shared_ptr<hittable> &child,
+                                 bool distribute,
+                                 const std::shared_ptr<transform> &original) {
+    if (auto inner = static_transform(child.get())) {
+      composed++;
+      layer merged{l.forward * inner->forward, inner->inverse * l.inverse,
+                   l.name,
+                   l.material_override ? l.material_override
+                                       : inner->material_override};
+      return push(merged, inner->object, distribute, nullptr);
+    }
+
+    if (bakes(l, *child, distribute))
+      return bake(l, child);
+
+    auto list = std::dynamic_pointer_cast<hittable_list>(child);
+    if (distribute && list && worth_distributing(l, *list)) {
+      auto result = std::make_shared<hittable_list>();
+      for (const auto &member : list->objects)
+        result->add(push(l, member, true, nullptr));
+      return result;
+    }
+
+    std::shared_ptr<hittable> content = flatten(child);
+    if (original && content == original->object)
+      return original;
+    auto t = instance_object(content, l.forward, l.inverse,
+                             l.material_override);
+    t->name = l.name;
+    return t;
+  }
+};
+
+#endif
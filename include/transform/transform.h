@@ -2,9 +2,13 @@
 #define TRANSFORM_H
 
 #include "../cenario/hittable.h"
+#include "../object/sphere.h"
+#include "../render_stats.h"
+#include "../vectors/affine3x4.h"
 #include "../vectors/mat4.h"
 #include "../vectors/vec4.h"
 #include "quaternion.h"
+#include <cmath>
 #include <memory>
 
 // [Requisito 1.3.1] Tipos de Objetos (Obrigatório)
@@ -20,50 +24,90 @@
 // escalar e cisalhar objetos na cena. A transformação é aplicada aos raios
 // antes de atingirem o objeto interno e as informações de hit (ponto e normal)
 // são transformadas de volta para o espaço global.
+//
+// O objeto interno é só lido, então vários transforms podem compartilhar o
+// mesmo (instâncias de um protótipo, como os coelhos ou os vagalumes): a
+// geometria existe uma vez e cada instância custa apenas as matrizes.
+// 'material_override', se definido, substitui o material de qualquer ponto
+// atingido dentro da instância.
 class transform : public hittable {
 public:
+  // Classe da matriz, decidida em set_transform, que escolhe o caminho de
+  // hit(): só translação (o raio local é o do mundo deslocado), translação
+  // com escala uniforme positiva (a normal não muda de direção), afim geral
+  // ou projetiva.
+  enum class matrix_kind { TRANSLATION, UNIFORM_SCALE, AFFINE, PROJECTIVE };
+
+  // Trocar o objeto por atribuição direta deixa o cache de hit() velho; use
+  // set_object.
   std::shared_ptr<hittable> object;
   mat4 forward;
   mat4 inverse;
-  mat4 normal_mat;
   std::string name;
+  std::shared_ptr<material> material_override;
+
+  // Unidades locais por unidade de mundo (maior norma das colunas da parte
+  // 3x3 da inversa). Converte hit_record::uv_scale para espaço de mundo.
+  double local_per_world = 1.0;
 
   transform() {}
 
   transform(std::shared_ptr<hittable> obj, const mat4 &fwd, const mat4 &inv)
       : object(obj), forward(fwd), inverse(inv) {
-    normal_mat = inv.transpose();
+    update_cache();
     name = obj->get_name();
   }
 
   void set_transform(const mat4 &fwd, const mat4 &inv) {
     forward = fwd;
     inverse = inv;
-    normal_mat = inv.transpose();
+    update_cache();
   }
 
-  bool hit(const ray &r, double t_min, double t_max,
-           hit_record &rec) const override {
-
-    vec4 origin4(r.origin(), 1.0);
-    vec4 dir4(r.direction(), 0.0);
+  void set_object(std::shared_ptr<hittable> obj) {
+    object = std::move(obj);
+    update_cache();
+  }
 
-    vec4 local_origin = inverse * origin4;
-    vec4 local_dir = inverse * dir4;
+  matrix_kind kind() const { return matrix_class; }
 
-    ray local_ray(local_origin.to_point3(), local_dir.to_vec3());
+  // Verdadeiro se a esfera interna foi dobrada na matriz (ver hit()).
+  bool folds_sphere() const { return folded_sphere != nullptr; }
 
-    if (!object->hit(local_ray, t_min, t_max, rec)) {
-      return false;
+  static double max_column_norm(const mat4 &m) {
+    double best = 0.0;
+    for (int j = 0; j < 3; j++) {
+      double n = m.m[0][j] * m.m[0][j] + m.m[1][j] * m.m[1][j] +
+                 m.m[2][j] * m.m[2][j];
+      best = std::fmax(best, n);
     }
+    return std::sqrt(best);
+  }
 
-    vec4 world_p = forward * vec4(rec.p, 1.0);
-    rec.p = world_p.to_point3();
+  // O raio vai ao espaço local sem ser normalizado: o ponto o + t * d do
+  // mundo é inv(o) + t * inv(d) no espaço local, então t_min, t_max e rec.t
+  // valem nos dois espaços, mesmo sob escala não uniforme, e o ponto do
+  // mundo sai de r.at(t) em vez de uma multiplicação por 'forward'.
+  //
+  // Translação e escala uniforme levam o raio com uma soma (e uma escala) e
+  // não mexem na direção da normal. Uma esfera sob uma delas continua uma
+  // esfera, de centro e raio já levados ao mundo em update_cache: o teste
+  // é feito direto com o raio do mundo, e o raio local só é calculado para
+  // preencher o registro quando há acerto.
+  bool hit(const ray &r, double t_min, double t_max,
+           hit_record &rec) const override {
+    if (folded_sphere)
+      return hit_folded_sphere(r, t_min, t_max, rec);
+    if (matrix_class == matrix_kind::PROJECTIVE)
+      return hit_projective(r, t_min, t_max, rec);
 
-    vec4 normal4 = normal_mat * vec4(rec.normal, 0.0);
-    rec.normal = unit_vector(normal4.to_vec3());
+    if (!object->hit(to_local(r), t_min, t_max, rec))
+      return false;
 
-    rec.object_name = name;
+    rec.p = r.at(rec.t);
+    if (matrix_class == matrix_kind::AFFINE)
+      rec.normal = unit_vector(inverse_affine.apply_transposed(rec.normal));
+    finish_record(rec);
     return true;
   }
 
@@ -105,8 +149,117 @@ public:
     output_box = aabb(new_min, new_max);
     return true;
   }
+
+private:
+  // 'inverse' como afim 3x4 (ver affine3x4.h); não usada se PROJECTIVE.
+  affine3x4 inverse_affine;
+  matrix_kind matrix_class = matrix_kind::AFFINE;
+
+  // Esfera interna dobrada na matriz, com centro e raio no mundo.
+  const sphere *folded_sphere = nullptr;
+  point3 sphere_center;
+  double sphere_radius = 0.0;
+
+  void update_cache() {
+    matrix_class = classify(forward, inverse);
+    inverse_affine = affine3x4(inverse);
+    local_per_world = max_column_norm(inverse);
+
+    folded_sphere = nullptr;
+    if (matrix_class == matrix_kind::TRANSLATION ||
+        matrix_class == matrix_kind::UNIFORM_SCALE) {
+      folded_sphere = dynamic_cast<const sphere *>(object.get());
+      if (folded_sphere) {
+        sphere_center = affine3x4(forward).apply_point(folded_sphere->center);
+        sphere_radius = folded_sphere->radius * forward.m[0][0];
+      }
+    }
+  }
+
+  // Comparações exatas: as fábricas abaixo e update_object_transform montam
+  // translações e escalas puras sem erro de arredondamento (ângulo zero dá
+  // cos 1 e sen 0 exatos), e uma matriz quase diagonal cai no caso afim,
+  // que é sempre correto.
+  static matrix_kind classify(const mat4 &fwd, const mat4 &inv) {
+    if (!affine3x4::is_affine(fwd) || !affine3x4::is_affine(inv))
+      return matrix_kind::PROJECTIVE;
+    for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 3; j++)
+        if (i != j && (inv.m[i][j] != 0.0 || fwd.m[i][j] != 0.0))
+          return matrix_kind::AFFINE;
+    double k = inv.m[0][0];
+    if (k <= 0.0 || inv.m[1][1] != k || inv.m[2][2] != k ||
+        fwd.m[1][1] != fwd.m[0][0] || fwd.m[2][2] != fwd.m[0][0])
+      return matrix_kind::AFFINE;
+    return k == 1.0 ? matrix_kind::TRANSLATION : matrix_kind::UNIFORM_SCALE;
+  }
+
+  ray to_local(const ray &r) const {
+    const vec3 &offset = inverse_affine.c[3];
+    switch (matrix_class) {
+    case matrix_kind::TRANSLATION:
+      return ray::unnormalized(r.origin() + offset, r.direction());
+    case matrix_kind::UNIFORM_SCALE: {
+      double k = inverse.m[0][0];
+      return ray::unnormalized(k * r.origin() + offset, k * r.direction());
+    }
+    default:
+      return ray::unnormalized(inverse_affine.apply_point(r.origin()),
+                               inverse_affine.apply_vector(r.direction()));
+    }
+  }
+
+  bool hit_folded_sphere(const ray &r, double t_min, double t_max,
+                         hit_record &rec) const {
+    RT_COUNT(primitive_tests);
+    double t;
+    if (!sphere::intersect(sphere_center, sphere_radius, r, t_min, t_max, t))
+      return false;
+    // u, v e uv_scale vêm da esfera original, no espaço local.
+    folded_sphere->fill_record(to_local(r), t, rec);
+    rec.p = r.at(t);
+    finish_record(rec);
+    return true;
+  }
+
+  void finish_record(hit_record &rec) const {
+    rec.uv_scale *= local_per_world;
+    if (material_override)
+      rec.mat = material_override;
+    rec.object_name = name;
+  }
+
+  // Matriz com linha projetiva (nenhuma das fábricas abaixo gera uma): o
+  // parâmetro do raio não se preserva, então o raio local é normalizado e
+  // rec.t é recalculado a partir do ponto no mundo.
+  bool hit_projective(const ray &r, double t_min, double t_max,
+                      hit_record &rec) const {
+    vec4 local_origin = inverse * vec4(r.origin(), 1.0);
+    vec4 local_dir = inverse * vec4(r.direction(), 0.0);
+    ray local_ray(local_origin.to_point3(), local_dir.to_vec3());
+    if (!object->hit(local_ray, t_min, t_max, rec))
+      return false;
+
+    rec.p = (forward * vec4(rec.p, 1.0)).to_point3();
+    rec.t = dot(rec.p - r.origin(), r.direction()) /
+            r.direction().length_squared();
+    rec.normal = unit_vector((inverse.transpose() * vec4(rec.normal, 0.0))
+                                 .to_vec3());
+    finish_record(rec);
+    return true;
+  }
 };
 
+// Instância de um protótipo compartilhado, com material próprio opcional.
+inline std::shared_ptr<transform>
+instance_object(std::shared_ptr<hittable> prototype, const mat4 &fwd,
+                const mat4 &inv,
+                std::shared_ptr<material> material_override = nullptr) {
+  auto t = std::make_shared<transform>(prototype, fwd, inv);
+  t->material_override = material_override;
+  return t;
+}
+
 // [Requisito 1.4.1] Translação (Obrigatório)
 // Desloca o objeto pelos valores tx, ty, tz.
 inline std::shared_ptr<transform>
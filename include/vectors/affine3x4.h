@@ -0,0 +1,46 @@
+#ifndef AFFINE3X4_H
+#define AFFINE3X4_H
+
+#include "mat4.h"
+#include "vec3.h"
+
+// Transformação afim: as três primeiras linhas de uma mat4 cuja última linha
+// é 0 0 0 1, guardadas por coluna. Um ponto custa 9 multiplicações e 9
+// somas, um vetor 9 e 6, contra as 16 e 12 de mat4 * vec4, sem a divisão
+// homogênea de to_point3. Cada produto é uma soma de colunas escaladas
+// (x * c0 + y * c1 + z * c2), operações de vec3 que o compilador faz aos
+// pares de doubles sem embaralhar os dados.
+class affine3x4 {
+public:
+  // c[0..2] são as colunas da parte linear; c[3] é a translação.
+  vec3 c[4];
+
+  affine3x4() : affine3x4(mat4()) {}
+
+  explicit affine3x4(const mat4 &a) {
+    for (int j = 0; j < 4; j++)
+      c[j] = vec3(a.m[0][j], a.m[1][j], a.m[2][j]);
+  }
+
+  // Verdadeiro se a última linha de 'a' for 0 0 0 1.
+  static bool is_affine(const mat4 &a) {
+    return a.m[3][0] == 0.0 && a.m[3][1] == 0.0 && a.m[3][2] == 0.0 &&
+           a.m[3][3] == 1.0;
+  }
+
+  point3 apply_point(const point3 &p) const {
+    return p.e[0] * c[0] + p.e[1] * c[1] + p.e[2] * c[2] + c[3];
+  }
+
+  vec3 apply_vector(const vec3 &v) const {
+    return v.e[0] * c[0] + v.e[1] * c[1] + v.e[2] * c[2];
+  }
+
+  // Multiplica pela transposta da parte linear: com a inversa, leva normais
+  // do espaço local para o do mundo (sem normalizar).
+  vec3 apply_transposed(const vec3 &v) const {
+    return vec3(dot(c[0], v), dot(c[1], v), dot(c[2], v));
+  }
+};
+
+#endif
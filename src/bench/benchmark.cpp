@@ -0,0 +1,565 @@
+// Benchmark reproduzível (sem janela): carrega a cena padrão, percorre um
+// conjunto de caminhos de câmera com nome e grava os tempos em JSON, para
+// comparar execuções entre commits.
+//
+// Com --golden, renderiza as cenas de dia e de noite na câmera padrão e
+// compara com as imagens de referência em golden/ (PSNR mínimo e limite de
+// pixels muito diferentes) e com o orçamento de tempo de cada caso; sai com
+// código 1 se algum caso falhar. --update-golden regrava as referências e os
+// orçamentos depois de uma mudança intencional na imagem.
+//
+//   benchmark.exe [--frames N] [--warmup N] [--only nome1,nome2]
+//                 [--label texto] [--out arquivo.json]
+//                 [--scene arquivo.cena] [--snapshot arquivo] [--verbose]
+//                 [--golden | --update-golden] [--golden-dir pasta]
+//                 [--min-psnr dB] [--budget-scale fator]
+
+#include "../../include/globals.h"
+#include "../../include/renderer.h"
+#include "../../include/scene_loader.h"
+#include "../../include/scene_setup.h"
+#include "../../include/textures/texture_cache.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <omp.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+// windows.h precisa vir antes de psapi.h.
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Pico de memória residente do processo, em MB.
+static double peak_rss_mb() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+    return pmc.PeakWorkingSetSize / (1024.0 * 1024.0);
+  return 0.0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0.0;
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+  return usage.ru_maxrss / 1024.0; // KB
+#endif
+#endif
+}
+
+// Memória residente atual, em MB; o pico acima nunca desce, então não
+// distingue um caminho do outro. Zero onde não há como medir.
+static double current_rss_mb() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+    return pmc.WorkingSetSize / (1024.0 * 1024.0);
+  return 0.0;
+#else
+  // Segundo campo de /proc/self/statm: páginas residentes (só Linux).
+  ifstream statm("/proc/self/statm");
+  long total_pages = 0, resident_pages = 0;
+  if (!(statm >> total_pages >> resident_pages))
+    return 0.0;
+  return resident_pages * (sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0));
+#endif
+}
+
+// Pose da câmera em um ponto do caminho.
+struct camera_key {
+  point3 eye;
+  point3 at;
+};
+
+// Caminho de câmera: 'setup' ajusta o estado global (projeção, preset, modo
+// noturno) e 'keys' dá as poses, interpoladas linearmente ao longo dos
+// quadros medidos. Sem poses, a câmera deixada pelo 'setup' é usada.
+struct camera_path {
+  string name;
+  function<void()> setup;
+  vector<camera_key> keys;
+};
+
+static const point3 SWORD_CENTER(900, 150, 900);
+
+static vector<camera_path> default_paths() {
+  vector<camera_path> paths;
+
+  paths.push_back({"padrao", [] {}, {}});
+
+  for (int preset = 1; preset <= 3; preset++) {
+    paths.push_back({"pontos_de_fuga_" + to_string(preset),
+                     [preset] { apply_vanishing_point_preset(preset); },
+                     {}});
+  }
+
+  paths.push_back({"ortografica", [] { current_projection = 1; }, {}});
+  paths.push_back({"obliqua", [] { current_projection = 2; }, {}});
+  paths.push_back({"noite", [] { toggle_day_night(true); }, {}});
+
+  // Aproximação da espada: do cabo até perto da lâmina e da guarda.
+  paths.push_back({"espada_close",
+                   [] {},
+                   {{SWORD_CENTER + vec3(70, 30, -70), SWORD_CENTER},
+                    {SWORD_CENTER + vec3(25, 10, -25), SWORD_CENTER}}});
+
+  return paths;
+}
+
+// Câmera inicial da cena (a padrão ou a definida no arquivo de --scene).
+static point3 start_eye = DEFAULT_CAM_EYE;
+static point3 start_at = DEFAULT_CAM_AT;
+static vec3 start_up = DEFAULT_CAM_UP;
+
+// Volta ao estado inicial da aplicação (câmera, projeção e modo dia).
+static void reset_view() {
+  if (is_night_mode)
+    toggle_day_night(false);
+  current_projection = 0;
+  vanishing_points_preset = 0;
+  cam_eye = start_eye;
+  cam_at = start_at;
+  cam_up = start_up;
+  setup_camera();
+}
+
+static void apply_key(const camera_path &path, int frame, int frames) {
+  if (path.keys.empty())
+    return;
+
+  double t = frames > 1 ? double(frame) / (frames - 1) : 0.0;
+  double pos = t * (path.keys.size() - 1);
+  size_t k = min(path.keys.size() - 1, static_cast<size_t>(pos));
+  size_t k1 = min(path.keys.size() - 1, k + 1);
+  double f = pos - k;
+
+  cam_eye = path.keys[k].eye * (1.0 - f) + path.keys[k1].eye * f;
+  cam_at = path.keys[k].at * (1.0 - f) + path.keys[k1].at * f;
+  setup_camera();
+}
+
+// Percentil pelo método do posto mais próximo.
+static double percentile(vector<double> values, double p) {
+  if (values.empty())
+    return 0.0;
+  sort(values.begin(), values.end());
+  size_t rank = static_cast<size_t>(ceil(p * values.size()));
+  return values[max<size_t>(rank, 1) - 1];
+}
+
+struct path_result {
+  string name;
+  vector<double> frame_ms;
+  vector<double> rays_per_second;
+  render_frame_stats last;
+  double rss_mb = 0.0;
+};
+
+static string json_string(const string &s) {
+  string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\')
+      out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+
+// ---------------------------------------------------------------------------
+// Regressão por imagem de referência.
+
+// Casos de referência: cena do dia e da noite vistas da câmera padrão. A cena
+// é determinística (cada parte sorteia do seu fluxo de SCENE_SEED), então a
+// mesma build reproduz a imagem byte a byte.
+struct golden_case {
+  string name;
+  bool night;
+};
+
+static const golden_case GOLDEN_CASES[] = {{"dia", false}, {"noite", true}};
+
+// Folga aplicada à mediana medida ao gravar um orçamento novo.
+static const double BUDGET_MARGIN = 1.5;
+
+// Um pixel conta como "muito diferente" se algum canal mudar mais que isto;
+// pega defeitos localizados que quase não mexem no PSNR.
+static const int OUTLIER_LEVELS = 32;
+static const double MAX_OUTLIER_FRACTION = 0.001;
+
+struct golden_options {
+  bool check = false;
+  bool update = false;
+  string dir = "golden";
+  double min_psnr = 40.0;
+  double budget_scale = 1.0;
+};
+
+// PixelBuffer guarda as linhas de baixo para cima (glDrawPixels); o PPM é
+// gravado de cima para baixo para abrir direto em qualquer visualizador.
+static bool write_ppm(const string &path, const unsigned char *pixels) {
+  ofstream out(path, ios::binary);
+  if (!out)
+    return false;
+  out << "P6\n" << IMAGE_WIDTH << " " << IMAGE_HEIGHT << "\n255\n";
+  for (int y = IMAGE_HEIGHT - 1; y >= 0; y--)
+    out.write(reinterpret_cast<const char *>(pixels + y * IMAGE_WIDTH * 3),
+              IMAGE_WIDTH * 3);
+  return bool(out);
+}
+
+static bool read_ppm(const string &path, vector<unsigned char> &pixels) {
+  ifstream in(path, ios::binary);
+  string magic;
+  int width = 0, height = 0, max_value = 0;
+  if (!(in >> magic >> width >> height >> max_value) || magic != "P6" ||
+      width != IMAGE_WIDTH || height != IMAGE_HEIGHT || max_value != 255)
+    return false;
+  in.get(); // um único espaço separa o cabeçalho dos dados
+
+  pixels.assign(IMAGE_WIDTH * IMAGE_HEIGHT * 3, 0);
+  for (int y = IMAGE_HEIGHT - 1; y >= 0; y--)
+    in.read(reinterpret_cast<char *>(&pixels[y * IMAGE_WIDTH * 3]),
+            IMAGE_WIDTH * 3);
+  return bool(in);
+}
+
+struct image_diff {
+  double psnr = 0.0; // infinito para imagens idênticas
+  int max_difference = 0;
+  double outlier_fraction = 0.0;
+};
+
+static image_diff compare_images(const unsigned char *a,
+                                 const unsigned char *b) {
+  const size_t pixel_count = size_t(IMAGE_WIDTH) * IMAGE_HEIGHT;
+  double squared_error = 0.0;
+  size_t outliers = 0;
+  image_diff diff;
+
+  for (size_t i = 0; i < pixel_count; i++) {
+    int worst = 0;
+    for (int c = 0; c < 3; c++) {
+      int d = abs(int(a[i * 3 + c]) - int(b[i * 3 + c]));
+      squared_error += double(d) * d;
+      worst = max(worst, d);
+    }
+    diff.max_difference = max(diff.max_difference, worst);
+    outliers += worst > OUTLIER_LEVELS;
+  }
+
+  double mse = squared_error / (pixel_count * 3);
+  diff.psnr = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse)
+                        : numeric_limits<double>::infinity();
+  diff.outlier_fraction = double(outliers) / pixel_count;
+  return diff;
+}
+
+// Orçamentos de tempo por caso ("nome ms" por linha).
+static map<string, double> read_budgets(const string &path) {
+  map<string, double> budgets;
+  ifstream in(path);
+  string name;
+  double ms;
+  while (in >> name >> ms)
+    budgets[name] = ms;
+  return budgets;
+}
+
+static bool write_budgets(const string &path,
+                          const map<string, double> &budgets) {
+  ofstream out(path);
+  if (!out)
+    return false;
+  out << fixed << setprecision(0);
+  for (const auto &entry : budgets)
+    out << entry.first << " " << entry.second << "\n";
+  return bool(out);
+}
+
+static int run_golden(const golden_options &opt, int frames, int warmup) {
+  const string budgets_path = opt.dir + "/orcamentos.txt";
+  map<string, double> budgets = read_budgets(budgets_path);
+  int failures = 0;
+
+  for (const golden_case &gc : GOLDEN_CASES) {
+    reset_view();
+    if (gc.night) {
+      toggle_day_night(true);
+      texture_cache::instance().wait_all();
+    }
+
+    vector<double> frame_ms;
+    for (int f = -warmup; f < frames; f++) {
+      render();
+      if (f >= 0)
+        frame_ms.push_back(last_frame_stats().frame_ms);
+    }
+    double median_ms = percentile(frame_ms, 0.5);
+    const string image_path = opt.dir + "/" + gc.name + ".ppm";
+
+    if (opt.update) {
+      budgets[gc.name] = ceil(median_ms * BUDGET_MARGIN);
+      if (!write_ppm(image_path, PixelBuffer)) {
+        cerr << "Erro ao gravar " << image_path << "\n";
+        return 1;
+      }
+      cerr << "  " << left << setw(8) << gc.name << right
+           << " referencia gravada, orcamento " << budgets[gc.name]
+           << " ms (mediana " << median_ms << " ms)\n";
+      continue;
+    }
+
+    vector<unsigned char> reference;
+    if (!read_ppm(image_path, reference)) {
+      cerr << "  " << gc.name << ": referencia " << image_path
+           << " ausente ou invalida (use --update-golden)\n";
+      failures++;
+      continue;
+    }
+
+    image_diff diff = compare_images(PixelBuffer, reference.data());
+    bool image_ok = diff.psnr >= opt.min_psnr &&
+                    diff.outlier_fraction <= MAX_OUTLIER_FRACTION;
+
+    auto budget = budgets.find(gc.name);
+    double budget_ms = budget != budgets.end()
+                           ? budget->second * opt.budget_scale
+                           : numeric_limits<double>::infinity();
+    bool time_ok = median_ms <= budget_ms;
+
+    cerr << "  " << left << setw(8) << gc.name << right << " PSNR "
+         << setw(6) << diff.psnr << " dB, dif. max " << setw(3)
+         << diff.max_difference << ", " << setprecision(3)
+         << 100.0 * diff.outlier_fraction << "% muito diferentes"
+         << setprecision(1) << (image_ok ? "" : " [IMAGEM]") << "; mediana "
+         << median_ms << " ms / orcamento " << budget_ms << " ms"
+         << (time_ok ? "" : " [TEMPO]") << "\n";
+
+    if (!image_ok || !time_ok) {
+      write_ppm(opt.dir + "/" + gc.name + "_atual.ppm", PixelBuffer);
+      failures++;
+    }
+  }
+
+  if (opt.update) {
+    if (!write_budgets(budgets_path, budgets)) {
+      cerr << "Erro ao gravar " << budgets_path << "\n";
+      return 1;
+    }
+    cerr << "Referencias atualizadas em " << opt.dir << "\n";
+    return 0;
+  }
+
+  if (failures) {
+    cerr << failures << " caso(s) fora da tolerancia; imagens atuais gravadas"
+         << " como <caso>_atual.ppm em " << opt.dir << "\n";
+    return 1;
+  }
+  cerr << "Todas as referencias conferem\n";
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+
+static void write_json(ostream &out, const string &label, int frames,
+                       int warmup, double startup_ms,
+                       const vector<path_result> &results) {
+  out << fixed << setprecision(3);
+  out << "{\n";
+  out << "  \"label\": " << json_string(label) << ",\n";
+  out << "  \"image\": [" << IMAGE_WIDTH << ", " << IMAGE_HEIGHT << "],\n";
+  out << "  \"threads\": " << omp_get_max_threads() << ",\n";
+  out << "  \"frames\": " << frames << ",\n";
+  out << "  \"warmup\": " << warmup << ",\n";
+  out << "  \"startup_ms\": " << startup_ms << ",\n";
+  out << "  \"peak_rss_mb\": " << peak_rss_mb() << ",\n";
+  out << "  \"paths\": [\n";
+
+  for (size_t i = 0; i < results.size(); i++) {
+    const path_result &r = results[i];
+    const ray_cost_counters &c = r.last.rays;
+
+    out << "    {\n";
+    out << "      \"name\": " << json_string(r.name) << ",\n";
+    out << "      \"frame_ms_median\": " << percentile(r.frame_ms, 0.5)
+        << ",\n";
+    out << "      \"frame_ms_p95\": " << percentile(r.frame_ms, 0.95) << ",\n";
+    out << "      \"frame_ms\": [";
+    for (size_t k = 0; k < r.frame_ms.size(); k++)
+      out << (k ? ", " : "") << r.frame_ms[k];
+    out << "],\n";
+    out << "      \"rays_per_second_median\": "
+        << percentile(r.rays_per_second, 0.5) << ",\n";
+    out << "      \"primary_rays\": " << c.primary_rays << ",\n";
+    out << "      \"shadow_rays\": " << c.shadow_rays << ",\n";
+    out << "      \"occluded_fraction\": " << r.last.occluded_fraction()
+        << ",\n";
+    out << "      \"node_visits\": " << c.node_visits << ",\n";
+    out << "      \"primitive_tests\": " << c.primitive_tests << ",\n";
+    out << "      \"texture_samples\": " << c.texture_samples << ",\n";
+    out << "      \"rss_mb\": " << r.rss_mb << "\n";
+    out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+
+  out << "  ]\n";
+  out << "}\n";
+}
+
+int main(int argc, char **argv) {
+  int frames = 3;
+  int warmup = 1;
+  string only;
+  string label;
+  string out_path = "bench_results.json";
+  string scene_path;
+  string snapshot_path;
+  bool verbose = false;
+  golden_options golden;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--frames" && has_value)
+      frames = max(1, atoi(argv[++i]));
+    else if (arg == "--warmup" && has_value)
+      warmup = max(0, atoi(argv[++i]));
+    else if (arg == "--only" && has_value)
+      only = "," + string(argv[++i]) + ",";
+    else if (arg == "--label" && has_value)
+      label = argv[++i];
+    else if (arg == "--out" && has_value)
+      out_path = argv[++i];
+    else if (arg == "--scene" && has_value)
+      scene_path = argv[++i];
+    else if (arg == "--snapshot" && has_value)
+      snapshot_path = argv[++i];
+    else if (arg == "--verbose")
+      verbose = true;
+    else if (arg == "--golden")
+      golden.check = true;
+    else if (arg == "--update-golden")
+      golden.update = true;
+    else if (arg == "--golden-dir" && has_value)
+      golden.dir = argv[++i];
+    else if (arg == "--min-psnr" && has_value)
+      golden.min_psnr = atof(argv[++i]);
+    else if (arg == "--budget-scale" && has_value)
+      golden.budget_scale = max(0.0, atof(argv[++i]));
+    else {
+      cerr << "Uso: " << argv[0]
+           << " [--frames N] [--warmup N] [--only nome1,nome2]"
+              " [--label texto] [--out arquivo.json] [--scene arquivo.cena]"
+              " [--snapshot arquivo] [--verbose]"
+              " [--golden | --update-golden] [--golden-dir pasta]"
+              " [--min-psnr dB] [--budget-scale fator]\n";
+      return 1;
+    }
+  }
+
+  // As mensagens da cena e do renderizador só aparecem com --verbose.
+  ostringstream discarded;
+  streambuf *console = cout.rdbuf();
+  if (!verbose)
+    cout.rdbuf(discarded.rdbuf());
+
+  PixelBuffer = new unsigned char[IMAGE_WIDTH * IMAGE_HEIGHT * 3];
+
+  auto start = chrono::steady_clock::now();
+  // Com --snapshot, o tempo de carga mede a leitura do snapshot (ou, na
+  // primeira execução, a montagem normal seguida da gravação).
+  if (snapshot_path.empty() ||
+      !load_scene_snapshot(snapshot_path, scene_path)) {
+    if (scene_path.empty()) {
+      create_scene();
+    } else if (!load_scene_file(scene_path)) {
+      cout.rdbuf(console);
+      return 1;
+    }
+    build_scene_bvh();
+    if (!snapshot_path.empty())
+      save_scene_snapshot(snapshot_path);
+  }
+  texture_cache::instance().wait_all();
+  double startup_ms =
+      chrono::duration<double, milli>(chrono::steady_clock::now() - start)
+          .count();
+
+  start_eye = cam_eye;
+  start_at = cam_at;
+  start_up = cam_up;
+
+  cerr << fixed << setprecision(1) << "Cena carregada em " << startup_ms
+       << " ms; " << frames << " quadros medidos (+" << warmup
+       << " de aquecimento) por caminho\n";
+
+  if (golden.check || golden.update) {
+    int status = run_golden(golden, frames, warmup);
+    cout.rdbuf(console);
+    delete[] PixelBuffer;
+    return status;
+  }
+
+  vector<path_result> results;
+  for (const camera_path &path : default_paths()) {
+    if (!only.empty() && only.find("," + path.name + ",") == string::npos)
+      continue;
+
+    reset_view();
+    path.setup();
+    setup_camera();
+
+    path_result result;
+    result.name = path.name;
+
+    for (int f = -warmup; f < frames; f++) {
+      apply_key(path, max(f, 0), frames);
+      render();
+      if (f < 0)
+        continue;
+
+      const render_frame_stats &stats = last_frame_stats();
+      result.frame_ms.push_back(stats.frame_ms);
+      result.rays_per_second.push_back(stats.rays_per_second());
+      result.last = stats;
+    }
+    result.rss_mb = current_rss_mb();
+
+    cerr << "  " << left << setw(18) << path.name << right << " mediana "
+         << setw(8) << percentile(result.frame_ms, 0.5) << " ms, p95 "
+         << setw(8) << percentile(result.frame_ms, 0.95) << " ms, "
+         << setw(5) << percentile(result.rays_per_second, 0.5) / 1e6
+         << " Mraios/s, " << result.rss_mb << " MB\n";
+    results.push_back(result);
+  }
+
+  cout.rdbuf(console);
+
+  ofstream out(out_path);
+  if (!out) {
+    cerr << "Erro ao gravar " << out_path << "\n";
+    return 1;
+  }
+  write_json(out, label, frames, warmup, startup_ms, results);
+  cerr << "Resultados gravados em " << out_path << "\n";
+
+  delete[] PixelBuffer;
+  return 0;
+}
@@ -0,0 +1,561 @@
+// Micro-benchmark dos kernels de interseção: mede ns/raio de sphere,
+// cylinder, cone, triangle, plane, aabb (uma caixa e oito com o mesmo raio)
+// e transform (de esferas e de um cone) com lotes de raios determinísticos
+// que acertam ou erram o objeto, e confere cada resultado com uma
+// implementação de referência independente (escrita para ser simples, não
+// rápida). Sai com código 1 se algum kernel divergir.
+//
+//   intersect_bench.exe [--rays N] [--repeat N] [--seed S]
+
+#include "../../include/cenario/aabb.h"
+#include "../../include/malha/triangle.h"
+#include "../../include/object/cone.h"
+#include "../../include/object/cylinder.h"
+#include "../../include/object/plane.h"
+#include "../../include/object/sphere.h"
+#include "../../include/transform/transform.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const double INF = numeric_limits<double>::infinity();
+static const double T_MIN = 0.001;
+
+// Gerador determinístico (xorshift64*): o mesmo lote em qualquer plataforma.
+class ray_rng {
+public:
+  explicit ray_rng(uint64_t seed) : state(seed ? seed : 1) {}
+
+  double uniform() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return ((state * 2685821657736338717ull) >> 11) *
+           (1.0 / 9007199254740992.0);
+  }
+
+  double uniform(double lo, double hi) { return lo + (hi - lo) * uniform(); }
+
+  vec3 unit() {
+    double z = uniform(-1.0, 1.0);
+    double phi = uniform(0.0, 2.0 * pi);
+    double s = std::sqrt(1.0 - z * z);
+    return vec3(s * std::cos(phi), s * std::sin(phi), z);
+  }
+
+private:
+  uint64_t state;
+};
+
+// Lotes de raios em torno de 'box'. As origens ficam numa esfera de raio
+// 3R (R = raio da esfera envolvente). "acerto": o raio mira um ponto
+// aleatório dentro da caixa. "erro": mira um ponto deslocado 1.5R a 3R na
+// perpendicular, de modo que passa fora da esfera envolvente.
+static vector<ray> make_rays(const aabb &box, bool aim_inside, size_t count,
+                             ray_rng &rng) {
+  point3 center = 0.5 * (box.minimum + box.maximum);
+  double radius = 0.5 * (box.maximum - box.minimum).length();
+
+  vector<ray> rays;
+  rays.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    point3 origin = center + 3.0 * radius * rng.unit();
+    point3 target;
+    if (aim_inside) {
+      target = point3(rng.uniform(box.minimum.x(), box.maximum.x()),
+                      rng.uniform(box.minimum.y(), box.maximum.y()),
+                      rng.uniform(box.minimum.z(), box.maximum.z()));
+    } else {
+      vec3 to_center = unit_vector(center - origin);
+      vec3 side = cross(to_center, rng.unit());
+      if (side.length_squared() < 1e-12)
+        side = cross(to_center, vec3(0, 1, 0));
+      target = center + rng.uniform(1.5, 3.0) * radius * unit_vector(side);
+    }
+    rays.push_back(ray(origin, unit_vector(target - origin)));
+  }
+  return rays;
+}
+
+// ---------------------------------------------------------------------------
+// Referências. Cada uma devolve true e o menor t em [T_MIN, t_max].
+
+static bool keep_nearest(double t, double t_max, double &best) {
+  if (t >= T_MIN && t <= t_max && t < best) {
+    best = t;
+    return true;
+  }
+  return false;
+}
+
+// Base ortonormal (u, v, axis) para trabalhar no referencial do objeto.
+static void basis(const vec3 &axis, vec3 &u, vec3 &v) {
+  vec3 helper = std::fabs(axis.x()) < 0.9 ? vec3(1, 0, 0) : vec3(0, 1, 0);
+  u = unit_vector(cross(helper, axis));
+  v = cross(axis, u);
+}
+
+// Raízes reais de a t^2 + b t + c = 0 (forma numericamente estável).
+static int solve_quadratic(double a, double b, double c, double roots[2]) {
+  if (std::fabs(a) < 1e-12) {
+    if (std::fabs(b) < 1e-12)
+      return 0;
+    roots[0] = -c / b;
+    return 1;
+  }
+  double disc = b * b - 4.0 * a * c;
+  if (disc < 0.0)
+    return 0;
+  double q = -0.5 * (b + std::copysign(std::sqrt(disc), b));
+  roots[0] = q / a;
+  roots[1] = q != 0.0 ? c / q : roots[0];
+  return 2;
+}
+
+static bool ref_sphere(const sphere &s, const ray &r, double &t) {
+  vec3 oc = r.origin() - s.center;
+  double roots[2];
+  int n = solve_quadratic(dot(r.direction(), r.direction()),
+                          2.0 * dot(oc, r.direction()),
+                          dot(oc, oc) - s.radius * s.radius, roots);
+  double best = INF;
+  for (int i = 0; i < n; i++)
+    keep_nearest(roots[i], INF, best);
+  t = best;
+  return best < INF;
+}
+
+static bool ref_plane(const plane &p, const ray &r, double &t) {
+  double denom = dot(r.direction(), p.normal);
+  if (std::fabs(denom) < 1e-8)
+    return false;
+  double best = INF;
+  keep_nearest(dot(p.point - r.origin(), p.normal) / denom, INF, best);
+  t = best;
+  return best < INF;
+}
+
+// Interseção com o plano do triângulo e teste das três arestas.
+static bool ref_triangle(const triangle &tri, const ray &r, double &t) {
+  vec3 n = cross(tri.v1 - tri.v0, tri.v2 - tri.v0);
+  double denom = dot(r.direction(), n);
+  if (std::fabs(denom) < 1e-12)
+    return false;
+  double th = dot(tri.v0 - r.origin(), n) / denom;
+  if (th < T_MIN)
+    return false;
+
+  point3 p = r.at(th);
+  const point3 *v[3] = {&tri.v0, &tri.v1, &tri.v2};
+  for (int e = 0; e < 3; e++) {
+    vec3 edge = *v[(e + 1) % 3] - *v[e];
+    if (dot(cross(edge, p - *v[e]), n) < 0.0)
+      return false;
+  }
+  t = th;
+  return true;
+}
+
+// Disco de centro 'c', normal 'n' e raio 'radius'.
+static void ref_disk(const point3 &c, const vec3 &n, double radius,
+                     const ray &r, double &best) {
+  double denom = dot(r.direction(), n);
+  if (std::fabs(denom) < 1e-12)
+    return;
+  double t = dot(c - r.origin(), n) / denom;
+  if ((r.at(t) - c).length_squared() <= radius * radius)
+    keep_nearest(t, INF, best);
+}
+
+// Cilindro fechado no referencial (u, v, axis) com base em z = 0.
+static bool ref_cylinder(const cylinder &cyl, const ray &r, double &t) {
+  vec3 u, v;
+  basis(cyl.axis, u, v);
+  vec3 o = r.origin() - cyl.base_center;
+  vec3 d = r.direction();
+  double ox = dot(o, u), oy = dot(o, v), oz = dot(o, cyl.axis);
+  double dx = dot(d, u), dy = dot(d, v), dz = dot(d, cyl.axis);
+
+  double best = INF;
+  double roots[2];
+  int n = solve_quadratic(dx * dx + dy * dy, 2.0 * (ox * dx + oy * dy),
+                          ox * ox + oy * oy - cyl.radius * cyl.radius, roots);
+  for (int i = 0; i < n; i++) {
+    double z = oz + roots[i] * dz;
+    if (z >= 0.0 && z <= cyl.height)
+      keep_nearest(roots[i], INF, best);
+  }
+  ref_disk(cyl.base_center, cyl.axis, cyl.radius, r, best);
+  ref_disk(cyl.base_center + cyl.height * cyl.axis, cyl.axis, cyl.radius, r,
+           best);
+  t = best;
+  return best < INF;
+}
+
+// Cone com vértice na origem do referencial, abrindo ao longo de +axis:
+// x^2 + y^2 = (z tan(angle))^2 com 0 <= z <= height, fechado pela base.
+static bool ref_cone(const cone &cn, const ray &r, double &t) {
+  vec3 u, v;
+  basis(cn.axis, u, v);
+  vec3 o = r.origin() - cn.apex;
+  vec3 d = r.direction();
+  double ox = dot(o, u), oy = dot(o, v), oz = dot(o, cn.axis);
+  double dx = dot(d, u), dy = dot(d, v), dz = dot(d, cn.axis);
+  double k = std::tan(cn.angle);
+  double k2 = k * k;
+
+  double best = INF;
+  double roots[2];
+  int n = solve_quadratic(dx * dx + dy * dy - k2 * dz * dz,
+                          2.0 * (ox * dx + oy * dy - k2 * oz * dz),
+                          ox * ox + oy * oy - k2 * oz * oz, roots);
+  for (int i = 0; i < n; i++) {
+    double z = oz + roots[i] * dz;
+    if (z >= 0.0 && z <= cn.height)
+      keep_nearest(roots[i], INF, best);
+  }
+  ref_disk(cn.apex + cn.height * cn.axis, cn.axis, cn.height * k, r, best);
+  t = best;
+  return best < INF;
+}
+
+// Slabs sem atalhos: intervalo [t_near, t_far] de cada eixo, com o caso de
+// direção nula tratado explicitamente.
+static bool ref_aabb(const aabb &box, const ray &r, double &t) {
+  double t_near = T_MIN, t_far = INF;
+  for (int a = 0; a < 3; a++) {
+    double o = r.origin()[a], d = r.direction()[a];
+    if (d == 0.0) {
+      if (o < box.minimum[a] || o > box.maximum[a])
+        return false;
+      continue;
+    }
+    double t0 = (box.minimum[a] - o) / d;
+    double t1 = (box.maximum[a] - o) / d;
+    t_near = std::max(t_near, std::min(t0, t1));
+    t_far = std::min(t_far, std::max(t0, t1));
+  }
+  t = t_near;
+  return t_far > t_near;
+}
+
+// Rotação de Rodrigues de 'p' em torno de 'axis' (unitário).
+static vec3 rodrigues(const vec3 &p, const vec3 &axis, double angle) {
+  double c = std::cos(angle), s = std::sin(angle);
+  return c * p + s * cross(axis, p) + (1.0 - c) * dot(axis, p) * axis;
+}
+
+// Esfera unitária levada ao mundo por T * R(axis, angle) * S: o raio é
+// levado ao espaço local desfazendo cada etapa separadamente.
+struct ellipsoid_reference {
+  vec3 translation, axis, scale;
+  double angle;
+
+  bool hit(const ray &r, double &t) const {
+    vec3 o = rodrigues(r.origin() - translation, axis, -angle);
+    vec3 d = rodrigues(r.direction(), axis, -angle);
+    o = vec3(o.x() / scale.x(), o.y() / scale.y(), o.z() / scale.z());
+    d = vec3(d.x() / scale.x(), d.y() / scale.y(), d.z() / scale.z());
+
+    double roots[2];
+    int n = solve_quadratic(dot(d, d), 2.0 * dot(o, d), dot(o, o) - 1.0, roots);
+    double best = INF;
+    for (int i = 0; i < n; i++)
+      keep_nearest(roots[i], INF, best);
+    t = best;
+    return best < INF;
+  }
+};
+
+// ---------------------------------------------------------------------------
+
+struct bench_options {
+  size_t rays = 200000;
+  int repeat = 5;
+  uint64_t seed = 12345;
+};
+
+static bool all_ok = true;
+static volatile double sink;
+
+// Mede e confere um kernel. 'kernel' e 'reference' recebem (ray, t&) e
+// devolvem se houve interseção.
+template <class Kernel, class Reference>
+static void run_case(const string &name, const aabb &bounds, Kernel kernel,
+                     Reference reference, const bench_options &opt) {
+  ray_rng rng(opt.seed ^ std::hash<string>()(name));
+
+  for (int mode = 0; mode < 2; mode++) {
+    bool aim_inside = mode == 0;
+    vector<ray> rays = make_rays(bounds, aim_inside, opt.rays, rng);
+
+    // Conferência com a referência.
+    size_t hits = 0, flag_mismatch = 0, t_mismatch = 0;
+    double worst_t_error = 0.0;
+    for (const ray &r : rays) {
+      double t = INF, t_ref = INF;
+      bool h = kernel(r, t);
+      bool h_ref = reference(r, t_ref);
+      hits += h;
+      if (h != h_ref) {
+        flag_mismatch++;
+      } else if (h) {
+        double err = std::fabs(t - t_ref) / std::max(1.0, std::fabs(t_ref));
+        worst_t_error = std::max(worst_t_error, err);
+        if (err > 1e-6)
+          t_mismatch++;
+      }
+    }
+
+    // Tempo: melhor de 'repeat' passadas pelo lote.
+    // O kernel é inlinado: a flag e o t de cada raio entram na soma, que
+    // vai para um volatile ao fim da passada, senão o compilador poderia
+    // descartar o cálculo de t.
+    double best_ns = INF;
+    for (int rep = 0; rep < opt.repeat; rep++) {
+      double sum = 0.0;
+      auto start = chrono::steady_clock::now();
+      for (const ray &r : rays) {
+        double t = INF;
+        bool h = kernel(r, t);
+        sum += h ? t : -1.0;
+      }
+      auto end = chrono::steady_clock::now();
+      sink = sum;
+      double ns = chrono::duration<double, nano>(end - start).count();
+      best_ns = std::min(best_ns, ns / rays.size());
+    }
+
+    // Raios rasantes podem cair de lados diferentes da borda nas duas
+    // implementações; toleramos uma fração muito pequena.
+    bool ok = flag_mismatch <= rays.size() / 10000 && t_mismatch == 0;
+    all_ok = all_ok && ok;
+
+    cout << left << setw(10) << name << setw(8)
+         << (aim_inside ? "acerto" : "erro") << right << fixed
+         << setprecision(1) << setw(8) << best_ns << " ns/raio" << setw(7)
+         << 100.0 * hits / rays.size() << "% acertos  "
+         << (ok ? "ok" : "DIVERGENTE") << " (" << flag_mismatch
+         << " divergencias, erro de t " << scientific << setprecision(1)
+         << worst_t_error << ")\n";
+  }
+}
+
+int main(int argc, char **argv) {
+  bench_options opt;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--rays" && has_value)
+      opt.rays = std::max(1000L, atol(argv[++i]));
+    else if (arg == "--repeat" && has_value)
+      opt.repeat = std::max(1, atoi(argv[++i]));
+    else if (arg == "--seed" && has_value)
+      opt.seed = strtoull(argv[++i], nullptr, 10);
+    else {
+      cerr << "Uso: " << argv[0] << " [--rays N] [--repeat N] [--seed S]\n";
+      return 1;
+    }
+  }
+
+  cout << "Kernels de intersecao: " << opt.rays << " raios por lote, melhor de "
+       << opt.repeat << " passadas, semente " << opt.seed << "\n";
+
+  shared_ptr<material> no_material;
+  hit_record rec;
+
+  // Geometria com as dimensões típicas da cena (unidades de mundo).
+  sphere sph(point3(10, 20, -5), 12.0, no_material);
+  aabb sph_box;
+  sph.bounding_box(sph_box);
+  run_case(
+      "sphere", sph_box,
+      [&](const ray &r, double &t) {
+        const hittable &h = sph;
+        bool hit = h.hit(r, T_MIN, INF, rec);
+        t = rec.t;
+        return hit;
+      },
+      [&](const ray &r, double &t) { return ref_sphere(sph, r, t); }, opt);
+
+  cylinder cyl(point3(0, 0, 0), vec3(0.2, 1, 0.1), 15.0, 120.0, no_material);
+  aabb cyl_box;
+  cyl.bounding_box(cyl_box);
+  run_case(
+      "cylinder", cyl_box,
+      [&](const ray &r, double &t) {
+        const hittable &h = cyl;
+        bool hit = h.hit(r, T_MIN, INF, rec);
+        t = rec.t;
+        return hit;
+      },
+      [&](const ray &r, double &t) { return ref_cylinder(cyl, r, t); }, opt);
+
+  cone cn = cone::from_base(point3(0, 40, 0), vec3(0, -1, 0.2), 6.0, 40.0,
+                            no_material);
+  aabb cone_box;
+  cn.bounding_box(cone_box);
+  run_case(
+      "cone", cone_box,
+      [&](const ray &r, double &t) {
+        const hittable &h = cn;
+        bool hit = h.hit(r, T_MIN, INF, rec);
+        t = rec.t;
+        return hit;
+      },
+      [&](const ray &r, double &t) { return ref_cone(cn, r, t); }, opt);
+
+  triangle tri(point3(0, 0, 0), point3(40, 5, 0), point3(10, 30, 8),
+               no_material);
+  aabb tri_box;
+  tri.bounding_box(tri_box);
+  run_case(
+      "triangle", tri_box,
+      [&](const ray &r, double &t) {
+        const hittable &h = tri;
+        bool hit = h.hit(r, T_MIN, INF, rec);
+        t = rec.t;
+        return hit;
+      },
+      [&](const ray &r, double &t) { return ref_triangle(tri, r, t); }, opt);
+
+  // O plano é infinito: boa parte dos raios "erro" ainda o atinge.
+  plane pl(point3(0, 0, 0), vec3(0, 1, 0), no_material);
+  run_case(
+      "plane", aabb(point3(-50, -5, -50), point3(50, 5, 50)),
+      [&](const ray &r, double &t) {
+        const hittable &h = pl;
+        bool hit = h.hit(r, T_MIN, INF, rec);
+        t = rec.t;
+        return hit;
+      },
+      [&](const ray &r, double &t) { return ref_plane(pl, r, t); }, opt);
+
+  // aabb::hit só responde sim/não; o t de entrada não é comparado.
+  aabb box(point3(-20, 0, -10), point3(30, 45, 25));
+  run_case(
+      "aabb", box,
+      [&](const ray &r, double &t) {
+        t = 0.0;
+        return box.hit(r, T_MIN, INF);
+      },
+      [&](const ray &r, double &t) {
+        bool hit = ref_aabb(box, r, t);
+        t = 0.0;
+        return hit;
+      },
+      opt);
+
+  // Um raio contra oito caixas, como os nós visitados num percurso da BVH.
+  // "aabb8" passa o raio a cada caixa (o inverso da direção é refeito em
+  // cada uma); "aabb8_q" monta um ray_query só. Acerto é atingir qualquer
+  // uma das caixas.
+  vector<aabb> cells;
+  for (int i = 0; i < 8; i++) {
+    point3 lo(-20 + 26 * (i & 1), 24 * ((i >> 1) & 1), -10 + 19 * (i >> 2));
+    cells.push_back(aabb(lo, lo + vec3(22, 20, 15)));
+  }
+  auto ref_cells = [&](const ray &r, double &t) {
+    bool hit = false;
+    for (const aabb &cell : cells)
+      hit |= ref_aabb(cell, r, t);
+    t = 0.0;
+    return hit;
+  };
+  run_case(
+      "aabb8", box,
+      [&](const ray &r, double &t) {
+        bool hit = false;
+        for (const aabb &cell : cells)
+          hit |= cell.hit(r, T_MIN, INF);
+        t = 0.0;
+        return hit;
+      },
+      ref_cells, opt);
+  run_case(
+      "aabb8_q", box,
+      [&](const ray &r, double &t) {
+        ray_query q(r);
+        bool hit = false;
+        for (const aabb &cell : cells)
+          hit |= cell.hit(q, T_MIN, INF);
+        t = 0.0;
+        return hit;
+      },
+      ref_cells, opt);
+
+  ellipsoid_reference ell{vec3(100, 50, -30), unit_vector(vec3(1, 1, 0)),
+                          vec3(30, 12, 20), 0.7};
+  auto unit_sphere = make_shared<sphere>(point3(0, 0, 0), 1.0, no_material);
+  auto xf = compose_transform(unit_sphere, ell.translation, ell.axis,
+                              ell.angle, ell.scale);
+  aabb xf_box;
+  xf->bounding_box(xf_box);
+  // O rec.t de transform::hit já é a distância no mundo, mesmo com a escala
+  // não uniforme do elipsoide.
+  run_case(
+      "transform", xf_box,
+      [&](const ray &r, double &t) {
+        const hittable &h = *xf;
+        bool hit = h.hit(r, T_MIN, INF, rec);
+        t = rec.t;
+        return hit;
+      },
+      [&](const ray &r, double &t) { return ell.hit(r, t); }, opt);
+
+  // Translação com escala uniforme sobre uma esfera: o transform testa a
+  // esfera já levada ao mundo (centro e raio dobrados na matriz).
+  auto xf_sph = compose_transform(make_shared<sphere>(sph), vec3(40, -15, 30),
+                                  vec3(0, 1, 0), 0.0, vec3(1.5, 1.5, 1.5));
+  sphere big_sph(1.5 * sph.center + vec3(40, -15, 30), 1.5 * sph.radius,
+                 no_material);
+  aabb xf_sph_box;
+  xf_sph->bounding_box(xf_sph_box);
+  run_case(
+      "xf_sphere", xf_sph_box,
+      [&](const ray &r, double &t) {
+        const hittable &h = *xf_sph;
+        bool hit = h.hit(r, T_MIN, INF, rec);
+        t = rec.t;
+        return hit;
+      },
+      [&](const ray &r, double &t) { return ref_sphere(big_sph, r, t); },
+      opt);
+
+  // Dentro de um transform com escala o raio local não tem direção unitária;
+  // escala uniforme mantém o cone um cone, comparável ao de referência.
+  const double k = 2.5;
+  const vec3 shift(-60, 10, 25);
+  auto small_cone = make_shared<cone>(cn);
+  auto xf_cone = translate_object(scale_object(small_cone, k, k, k),
+                                  shift.x(), shift.y(), shift.z());
+  cone big_cone = cn;
+  big_cone.apex = k * cn.apex + shift;
+  big_cone.height = k * cn.height;
+  aabb xf_cone_box;
+  xf_cone->bounding_box(xf_cone_box);
+  run_case(
+      "xf_cone", xf_cone_box,
+      [&](const ray &r, double &t) {
+        const hittable &h = *xf_cone;
+        bool hit = h.hit(r, T_MIN, INF, rec);
+        t = rec.t;
+        return hit;
+      },
+      [&](const ray &r, double &t) { return ref_cone(big_cone, r, t); }, opt);
+
+  if (!all_ok) {
+    cout << "ERRO: kernels divergentes da referencia\n";
+    return 1;
+  }
+  return 0;
+}
@@ -1,4 +1,9 @@
 #include "../include/globals.h"
+#include "../include/profiler.h"
+#include "../include/scene_snapshot.h"
+#include "../include/transform/flatten_transforms.h"
+#include <iostream>
+#include <set>
 
 using namespace std;
 
@@ -19,6 +24,8 @@ int vanishing_points_preset = 0;
 bool need_redraw = true;
 string picked_object = "";
 
+string scene_file_path;
+
 bool is_night_mode = false;
 color sky_color_top(0.15, 0.2, 0.4);
 color sky_color_bottom(0.5, 0.4, 0.6);
@@ -49,5 +56,42 @@ bool use_preview = false;
 bool frame_cached = false;
 
 bvh_scene scene_bvh;
+unsigned int scene_bvh_version = 0;
+baked_shadow_visibility baked_shadows;
+heatmap_metric heatmap_mode = heatmap_metric::OFF;
+
+void build_scene_bvh() {
+  PROFILE_SCOPE("build_scene_bvh");
+  flatten_static_transforms();
+  scene_bvh.build(world.objects);
+  scene_bvh_version++;
+  baked_shadows.invalidate();
+}
+
+void flatten_static_transforms() {
+  PROFILE_SCOPE("flatten_static_transforms");
+  set<const hittable *> editable;
+  for (const auto &entry : object_transforms)
+    editable.insert(entry.second.get());
+
+  transform_flattener flattener(editable);
+  flattener.run(world.objects);
+  if (flattener.composed_layers() > 0 || flattener.baked_leaves() > 0)
+    cout << "Transforms: " << flattener.composed_layers()
+         << " camadas fixas compostas, " << flattener.baked_leaves()
+         << " dobradas na geometria\n";
+}
+
+bool save_scene_snapshot(const string &path) {
+  PROFILE_SCOPE("save_scene_snapshot");
+  return scene_snapshot::write(path);
+}
 
-void build_scene_bvh() { scene_bvh.build(world.objects); }
+bool load_scene_snapshot(const string &path, const string &scene_path) {
+  PROFILE_SCOPE("load_scene_snapshot");
+  if (!scene_snapshot::read(path, scene_path))
+    return false;
+  scene_bvh_version++;
+  baked_shadows.invalidate();
+  return true;
+}
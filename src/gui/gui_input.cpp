@@ -897,7 +897,7 @@ bool GUIManager::handleMouseClick(int mouse_x, int mouse_y, int button,
     return true;
   }
 
-  int tab_w = gui_width / 7;
+  int tab_w = gui_width / 8;
   int tab_y = gui_y + 25;
   int tab_h = 25;
 
@@ -928,10 +928,14 @@ bool GUIManager::handleMouseClick(int mouse_x, int mouse_y, int button,
       gui_height = 420;
       pending_values_loaded = false;
       return true;
-    } else if (mouse_x >= gui_x + tab_w * 6 && mouse_x <= gui_x + gui_width) {
+    } else if (mouse_x >= gui_x + tab_w * 6 && mouse_x < gui_x + tab_w * 7) {
       current_tab = 5; // Light Tab
       gui_height = 550;
       return true;
+    } else if (mouse_x >= gui_x + tab_w * 7 && mouse_x <= gui_x + gui_width) {
+      current_tab = 7; // Stats Tab
+      gui_height = 360;
+      return true;
     }
   }
 
@@ -8,7 +8,7 @@ using namespace std;
 bool GUIManager::gui_visible = false;
 int GUIManager::gui_x = 10;
 int GUIManager::gui_y = 10;
-int GUIManager::gui_width = 300;
+int GUIManager::gui_width = 336;
 int GUIManager::gui_height = 320;
 int GUIManager::current_tab = 0;
 
@@ -1,5 +1,6 @@
 #include "../../include/globals.h"
 #include "../../include/gui/gui_manager.h"
+#include "../../include/renderer.h"
 #include <algorithm>
 #include <iomanip>
 #include <iostream>
@@ -10,7 +11,7 @@ using namespace std;
 int GUIManager::selected_light_index = 0;
 
 void GUIManager::drawTabs() {
-  int tab_w = gui_width / 7;
+  int tab_w = gui_width / 8;
   int tab_h = 25;
   int tab_y = gui_y + 25;
 
@@ -28,6 +29,9 @@ void GUIManager::drawTabs() {
   drawButton(gui_x + tab_w * 5, tab_y, tab_w, tab_h, "Cisal", current_tab == 6);
 
   drawButton(gui_x + tab_w * 6, tab_y, tab_w, tab_h, "Luz", current_tab == 5);
+
+  drawButton(gui_x + tab_w * 7, tab_y, tab_w, tab_h, "Stats",
+             current_tab == 7);
 }
 
 void GUIManager::drawLightingTab() {
@@ -266,6 +270,57 @@ void GUIManager::drawEnvironmentTab() {
              is_night);
 }
 
+void GUIManager::drawStatsTab() {
+  int content_y = gui_y + 60;
+  int line_height = 20;
+
+  drawText(gui_x + 10, content_y, "=== Ultimo Quadro ===", 0.5f, 0.8f, 1.0f);
+  content_y += line_height * 2;
+
+  const render_frame_stats &s = last_frame_stats();
+  if (s.frame_ms <= 0.0) {
+    drawText(gui_x + 10, content_y, "Nenhum quadro renderizado.", 0.8f, 0.8f,
+             0.8f);
+    return;
+  }
+
+  const ray_cost_counters &c = s.rays;
+  double primary = std::max(1LL, c.primary_rays);
+
+  auto row = [&](const string &label, const string &value) {
+    drawText(gui_x + 10, content_y, label, 0.8f, 0.8f, 0.8f);
+    drawText(gui_x + 170, content_y, value, 1.0f, 1.0f, 0.5f);
+    content_y += line_height;
+  };
+  auto fmt = [](double value, int decimals) {
+    stringstream ss;
+    ss << fixed << setprecision(decimals) << value;
+    return ss.str();
+  };
+
+  row("Tipo:", string(s.preview ? "Preview " : "Completo ") +
+                   to_string(s.width) + "x" + to_string(s.height));
+  row("Tempo:", fmt(s.frame_ms, 1) + " ms");
+  row("Raios/s:", fmt(s.rays_per_second() / 1e6, 2) + " M");
+  row("Raios primarios:", to_string(c.primary_rays));
+  row("Raios de sombra:", to_string(c.shadow_rays));
+  row("Sombra ocluida:", fmt(100.0 * s.occluded_fraction(), 1) + "%");
+  content_y += line_height / 2;
+
+  drawText(gui_x + 10, content_y, "Por raio primario:", 0.5f, 0.8f, 1.0f);
+  content_y += line_height;
+  row("Nos da BVH:", fmt(c.node_visits / primary, 1));
+  row("Testes de primitivas:", fmt(c.primitive_tests / primary, 1));
+  row("Testes de triangulos:", fmt(c.triangle_tests / primary, 1));
+  row("Amostras de textura:", fmt(c.texture_samples / primary, 2));
+
+#ifdef RT_NO_STATS
+  content_y += line_height / 2;
+  drawText(gui_x + 10, content_y, "Contadores desativados (RT_NO_STATS)", 1.0f,
+           0.4f, 0.4f);
+#endif
+}
+
 void GUIManager::drawTransformTab() {
   int content_y = gui_y + 60;
   int line_height = 20;
@@ -686,6 +741,9 @@ void GUIManager::draw() {
   case 6:
     GUIManager::drawShearTab();
     break;
+  case 7:
+    drawStatsTab();
+    break;
   }
 }
 
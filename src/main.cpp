@@ -1,13 +1,18 @@
 
 
 #include <GL/freeglut.h>
+#include <cstring>
 #include <iostream>
+#include <string>
 
 #include "../include/globals.h"
 #include "../include/gui/gui_manager.h"
 #include "../include/input_handlers.h"
+#include "../include/profiler.h"
 #include "../include/renderer.h"
+#include "../include/scene_loader.h"
 #include "../include/scene_setup.h"
+#include "../include/textures/texture_cache.h"
 
 using namespace std;
 
@@ -17,14 +22,52 @@ int main(int argc, char **argv) {
   cout << "  Resolucao: " << IMAGE_WIDTH << "x" << IMAGE_HEIGHT << "\n";
   cout << "============================================\n\n";
 
+  // --trace <arquivo.json>: grava o perfil de inicialização no formato de
+  // trace do Chrome (abrir em chrome://tracing ou ui.perfetto.dev).
+  // --scene <arquivo.cena>: carrega a cena de um arquivo de texto em vez da
+  // cena embutida (formato descrito em include/scene_loader.h).
+  // --snapshot <arquivo>: carrega a cena (já com a BVH) do snapshot binário
+  // se ele existir e tiver sido gravado a partir da mesma cena (--scene ou a
+  // embutida) sem mudanças; senão monta a cena normalmente e grava o
+  // snapshot.
+  string trace_path;
+  string scene_path;
+  string snapshot_path;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (string(argv[i]) == "--trace")
+      trace_path = argv[i + 1];
+    else if (string(argv[i]) == "--scene")
+      scene_path = argv[i + 1];
+    else if (string(argv[i]) == "--snapshot")
+      snapshot_path = argv[i + 1];
+  }
+
+  profiler::set_thread_name("principal");
+  profiler::scope startup_scope("inicializacao");
+
   PixelBuffer = new unsigned char[IMAGE_WIDTH * IMAGE_HEIGHT * 3];
   memset(PixelBuffer, 0, IMAGE_WIDTH * IMAGE_HEIGHT * 3);
 
-  cout << "Criando cena...\n";
-  create_scene();
-
-  cout << "Construindo BVH para aceleracao...\n";
-  build_scene_bvh();
+  // As texturas são decodificadas em segundo plano (texture_cache) enquanto
+  // a cena, a BVH e a janela são montadas.
+  if (snapshot_path.empty() ||
+      !load_scene_snapshot(snapshot_path, scene_path)) {
+    if (scene_path.empty()) {
+      cout << "Criando cena...\n";
+      create_scene();
+    } else {
+      cout << "Carregando cena de " << scene_path << "...\n";
+      if (!load_scene_file(scene_path))
+        return 1;
+    }
+
+    cout << "Construindo BVH para aceleracao...\n";
+    build_scene_bvh();
+    if (!snapshot_path.empty())
+      save_scene_snapshot(snapshot_path);
+  }
+
+  profiler::scope window_scope("janela e GUI");
 
   glutInit(&argc, argv);
   glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
@@ -105,6 +148,20 @@ int main(int argc, char **argv) {
         }
       });
 
+  window_scope.finish();
+  startup_scope.finish();
+  profiler::report("Perfil de inicializacao:");
+
+  if (!trace_path.empty()) {
+    // O trace inclui a decodificação das texturas, que segue em segundo
+    // plano: só neste modo esperamos por ela.
+    texture_cache::instance().wait_all();
+    if (profiler::write_chrome_trace(trace_path))
+      cout << "Trace gravado em " << trace_path << "\n";
+    else
+      cerr << "Erro ao gravar trace em " << trace_path << "\n";
+  }
+
   cout << "\nSistema inicializado. Pressione H para lista de comandos.\n";
 
   glutMainLoop();
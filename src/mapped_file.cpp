@@ -0,0 +1,90 @@
+#include "../include/textures/mapped_file.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool mapped_file::open(const char *path) {
+  close();
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  file_handle = file;
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    close();
+    return false;
+  }
+  // Um arquivo vazio não pode ser mapeado; abre sem dados.
+  if (file_size.QuadPart == 0) {
+    close();
+    return true;
+  }
+  bytes = static_cast<size_t>(file_size.QuadPart);
+
+  mapping_handle =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping_handle) {
+    close();
+    return false;
+  }
+  base = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+#else
+  fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close();
+    return false;
+  }
+  // Um arquivo vazio não pode ser mapeado; abre sem dados.
+  if (st.st_size == 0) {
+    close();
+    return true;
+  }
+  bytes = static_cast<size_t>(st.st_size);
+
+  base = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (base == MAP_FAILED)
+    base = nullptr;
+#endif
+  if (!base) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void mapped_file::close() {
+#ifdef _WIN32
+  if (base)
+    UnmapViewOfFile(base);
+  if (mapping_handle)
+    CloseHandle(mapping_handle);
+  if (file_handle)
+    CloseHandle(file_handle);
+#else
+  if (base)
+    munmap(base, bytes);
+  if (fd >= 0)
+    ::close(fd);
+#endif
+  base = nullptr;
+  bytes = 0;
+  file_handle = nullptr;
+  mapping_handle = nullptr;
+  fd = -1;
+}
@@ -0,0 +1,266 @@
+#include "../include/profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+namespace profiler {
+
+struct event {
+  string name;
+  char phase; // 'X' (escopo) ou 'C' (contador)
+  int tid;
+  int depth;
+  double start_us;
+  double dur_us;
+  string args; // objeto JSON já formatado, ou vazio
+};
+
+static mutex events_mutex;
+static vector<event> events;
+static map<int, string> thread_names;
+static int next_tid = 0;
+static atomic<bool> capture_on(false);
+
+static thread_local int tl_tid = -1;
+static thread_local int tl_depth = 0;
+
+static const chrono::steady_clock::time_point origin =
+    chrono::steady_clock::now();
+
+double now_us() {
+  return chrono::duration<double, micro>(chrono::steady_clock::now() - origin)
+      .count();
+}
+
+// Chamada com events_mutex travado.
+static int current_tid() {
+  if (tl_tid < 0)
+    tl_tid = next_tid++;
+  return tl_tid;
+}
+
+void record(const string &name, double start_us, double end_us, int depth,
+            const string &args) {
+  lock_guard<mutex> lock(events_mutex);
+  events.push_back(
+      {name, 'X', current_tid(), depth, start_us, end_us - start_us, args});
+}
+
+scope::scope(const string &name)
+    : name(name), start_us(now_us()), depth(tl_depth++), open(true) {}
+
+void scope::finish() {
+  if (!open)
+    return;
+  open = false;
+  tl_depth--;
+  record(name, start_us, now_us(), depth);
+}
+
+trace_scope::trace_scope(const char *name)
+    : name(name), open(capturing()) {
+  if (open) {
+    depth = tl_depth++;
+    start_us = now_us();
+  }
+}
+
+void trace_scope::arg(const char *key, double value) {
+  if (!open)
+    return;
+  stringstream ss;
+  ss << (args.empty() ? "{" : ",") << "\"" << key << "\":" << value;
+  args += ss.str();
+}
+
+void trace_scope::finish() {
+  if (!open)
+    return;
+  open = false;
+  tl_depth--;
+  record(name, start_us, now_us(), depth, args.empty() ? "" : args + "}");
+}
+
+bool capturing() { return capture_on.load(memory_order_relaxed); }
+
+void set_capture(bool on) { capture_on.store(on, memory_order_relaxed); }
+
+void counter(const string &name, double value) {
+  if (!capturing())
+    return;
+  stringstream args;
+  args << "{\"valor\":" << value << "}";
+  double t = now_us();
+  lock_guard<mutex> lock(events_mutex);
+  events.push_back({name, 'C', current_tid(), 0, t, 0.0, args.str()});
+}
+
+void set_thread_name(const string &name) {
+  lock_guard<mutex> lock(events_mutex);
+  thread_names[current_tid()] = name;
+}
+
+void clear() {
+  lock_guard<mutex> lock(events_mutex);
+  events.clear();
+}
+
+// Nó da árvore agregada: eventos com o mesmo caminho (pai/filho/...) na
+// mesma thread são somados.
+struct tree_node {
+  string name;
+  int depth;
+  double first_start;
+  double total_us = 0.0;
+  int calls = 0;
+  string parent_path;
+};
+
+void report(const string &title) {
+  vector<event> snapshot;
+  map<int, string> names;
+  {
+    lock_guard<mutex> lock(events_mutex);
+    snapshot = events;
+    names = thread_names;
+  }
+  if (snapshot.empty())
+    return;
+
+  // Ordena por thread e início (pais antes dos filhos) e reconstrói o
+  // caminho de cada evento com uma pilha.
+  sort(snapshot.begin(), snapshot.end(), [](const event &a, const event &b) {
+    if (a.tid != b.tid)
+      return a.tid < b.tid;
+    if (a.start_us != b.start_us)
+      return a.start_us < b.start_us;
+    return a.depth < b.depth;
+  });
+
+  map<string, tree_node> nodes;
+  vector<string> order;
+  vector<pair<const event *, string>> stack;
+  int last_tid = -1;
+
+  for (const event &e : snapshot) {
+    if (e.phase != 'X')
+      continue;
+    if (e.tid != last_tid) {
+      stack.clear();
+      last_tid = e.tid;
+    }
+    while (!stack.empty() &&
+           (stack.back().first->depth >= e.depth ||
+            stack.back().first->start_us + stack.back().first->dur_us <
+                e.start_us))
+      stack.pop_back();
+
+    string parent =
+        stack.empty() ? "#" + to_string(e.tid) : stack.back().second;
+    string path = parent + "/" + e.name;
+
+    auto it = nodes.find(path);
+    if (it == nodes.end()) {
+      tree_node n;
+      n.name = e.name;
+      n.depth = static_cast<int>(stack.size());
+      n.first_start = e.start_us;
+      n.parent_path = parent;
+      it = nodes.emplace(path, n).first;
+      order.push_back(path);
+    }
+    it->second.total_us += e.dur_us;
+    it->second.calls++;
+
+    stack.push_back({&e, path});
+  }
+
+  stringstream ss;
+  ss << fixed << setprecision(1);
+  ss << title << "\n";
+  string current_root = "#0";
+  for (const string &path : order) {
+    const tree_node &n = nodes[path];
+    string root = path.substr(0, path.find('/'));
+    if (root != current_root) {
+      int tid = stoi(root.substr(1));
+      ss << "  [thread " << tid;
+      if (names.count(tid))
+        ss << ": " << names[tid];
+      ss << "]\n";
+      current_root = root;
+    }
+    // Escopos de outras threads ficam indentados sob o cabeçalho da thread.
+    int indent = 2 + 2 * n.depth + (root == "#0" ? 0 : 2);
+    string label = string(indent, ' ') + n.name;
+    ss << left << setw(48) << label << right << setw(10)
+       << n.total_us / 1000.0 << " ms";
+
+    auto parent = nodes.find(n.parent_path);
+    if (parent != nodes.end() && parent->second.total_us > 0.0)
+      ss << setw(7) << 100.0 * n.total_us / parent->second.total_us << "%";
+    if (n.calls > 1)
+      ss << "  (" << n.calls << "x)";
+    ss << "\n";
+  }
+  cout << ss.str();
+}
+
+static string json_escape(const string &s) {
+  string out;
+  for (char c : s) {
+    if (c == '"' || c == '\\')
+      out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+bool write_chrome_trace(const string &path) {
+  vector<event> snapshot;
+  map<int, string> names;
+  {
+    lock_guard<mutex> lock(events_mutex);
+    snapshot = events;
+    names = thread_names;
+  }
+
+  ofstream out(path);
+  if (!out)
+    return false;
+
+  out << fixed << setprecision(3);
+  out << "{\"traceEvents\":[";
+  const char *separator = "\n";
+  for (const auto &entry : names) {
+    out << separator
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+        << entry.first << ",\"args\":{\"name\":\""
+        << json_escape(entry.second) << "\"}}";
+    separator = ",\n";
+  }
+  for (const event &e : snapshot) {
+    out << separator << "{\"name\":\"" << json_escape(e.name)
+        << "\",\"cat\":\"raytracer\",\"ph\":\"" << e.phase
+        << "\",\"pid\":1,\"tid\":" << e.tid << ",\"ts\":" << e.start_us;
+    if (e.phase == 'X')
+      out << ",\"dur\":" << e.dur_us;
+    if (!e.args.empty())
+      out << ",\"args\":" << e.args;
+    out << "}";
+    separator = ",\n";
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return static_cast<bool>(out);
+}
+
+} // namespace profiler
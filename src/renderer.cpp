@@ -1,23 +1,146 @@
 #include "../include/renderer.h"
 #include "../include/globals.h"
+#include "../include/profiler.h"
 #include <algorithm>
 #include <cmath>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <omp.h>
+#include <sstream>
 
 using namespace std;
 
-color calculate_lighting_bvh(const hit_record &rec, const ray &r) {
+// Cache de oclusores de sombra (por thread e por luz).
+// Pixels vizinhos costumam compartilhar o mesmo oclusor para uma mesma luz
+// (copa das árvores, "Rocha Principal"). Antes de percorrer a BVH, o raio de
+// sombra é testado contra o último objeto que bloqueou aquela luz na thread.
+struct shadow_cache_entry {
+  const light *key = nullptr;
+  const hittable *occluder = nullptr;
+};
+
+static thread_local vector<shadow_cache_entry> shadow_cache;
+static thread_local unsigned int shadow_cache_bvh_version = 0;
+
+// Contadores de custo do quadro atual: cada thread zera os seus no início do
+// laço paralelo e os soma aqui ao final.
+static render_frame_stats frame_stats;
+
+const render_frame_stats &last_frame_stats() { return frame_stats; }
+
+static void begin_frame_stats(bool preview, int width, int height) {
+  frame_stats = render_frame_stats();
+  frame_stats.preview = preview;
+  frame_stats.width = width;
+  frame_stats.height = height;
+}
+
+static void merge_ray_counters() {
+#pragma omp critical(frame_ray_counters)
+  frame_stats.rays += render_stats::local;
+  render_stats::local = ray_cost_counters();
+}
+
+// Com a captura de trace ligada, dá nome às threads do OpenMP (a thread 0 é a
+// principal, já nomeada em main()).
+static void name_render_thread() {
+  if (profiler::capturing() && omp_get_thread_num() != 0)
+    profiler::set_thread_name("OpenMP " + to_string(omp_get_thread_num()));
+}
+
+static void report_shadow_cache_stats() {
+#ifdef RT_NO_STATS
+  // Os contadores do cache e da grade passam por RT_COUNT; sem eles não há
+  // taxa de acerto a relatar, e shadow_rays ficaria sempre em zero.
+  static bool warned = false;
+  if (!warned)
+    cout << "Cache de sombra: sem estatisticas (compilado com "
+            "-DRT_NO_STATS)\n";
+  warned = true;
+  return;
+#endif
+  const ray_cost_counters &c = frame_stats.rays;
+  if (c.shadow_rays == 0)
+    return;
+
+  profiler::counter("raios de sombra", double(c.shadow_rays));
+  profiler::counter("acertos do cache de sombra", double(c.shadow_cache_hits));
+  profiler::counter("sombras pela grade", double(c.baked_shadow_rays));
+
+  double hit_rate = c.shadow_cache_tries > 0 ? 100.0 * c.shadow_cache_hits /
+                                                   c.shadow_cache_tries
+                                             : 0.0;
+  cout << "Cache de sombra: " << c.shadow_cache_hits << " acertos em "
+       << c.shadow_cache_tries << " tentativas (" << hit_rate << "%), "
+       << c.shadow_rays << " raios de sombra\n";
+  if (baked_shadows.enabled) {
+    cout << "Sombras pre-calculadas: " << c.baked_shadow_rays
+         << " raios resolvidos pela grade ("
+         << 100.0 * c.baked_shadow_rays / c.shadow_rays << "%)\n";
+  }
+}
+
+// Retorna true se o ponto de origem de 'shadow_ray' está ocluído para a luz
+// 'light_index' no intervalo (0.001, t_max).
+static bool shadow_occluded(const ray &shadow_ray, double t_max,
+                            size_t light_index, const light *light_ptr) {
+  if (shadow_cache_bvh_version != scene_bvh_version) {
+    // A BVH foi reconstruída: os ponteiros guardados podem ser de objetos
+    // que já saíram da cena.
+    shadow_cache.clear();
+    shadow_cache_bvh_version = scene_bvh_version;
+  }
+  if (light_index >= shadow_cache.size())
+    shadow_cache.resize(light_index + 1);
+
+  shadow_cache_entry &entry = shadow_cache[light_index];
+  if (entry.key != light_ptr) {
+    entry.key = light_ptr;
+    entry.occluder = nullptr;
+  }
+
+  RT_COUNT(shadow_rays);
+
+  const hittable *occluder = nullptr;
+
+  // Luz estática: se a grade garante que nada limitado bloqueia este ponto,
+  // só resta testar os objetos sem bounding box (chão).
+  if (const shadow_visibility_grid *grid = baked_shadows.grid(light_index)) {
+    if (grid->is_clear(shadow_ray.origin())) {
+      RT_COUNT(baked_shadow_rays);
+      return scene_bvh.hit_any_unbounded(shadow_ray, 0.001, t_max, occluder);
+    }
+  }
+
+  if (entry.occluder) {
+    RT_COUNT(shadow_cache_tries);
+    if (entry.occluder->hit_any(shadow_ray, 0.001, t_max, occluder)) {
+      RT_COUNT(shadow_cache_hits);
+      return true;
+    }
+  }
+
+  if (scene_bvh.hit_any(shadow_ray, 0.001, t_max, occluder)) {
+    entry.occluder = occluder;
+    return true;
+  }
+  return false;
+}
+
+color calculate_lighting_bvh(const hit_record &rec, const ray &r,
+                             const texture_query &tex_query) {
   color result(0, 0, 0);
 
   result = result + rec.mat->emission;
 
-  color diffuse_color = rec.mat->get_diffuse(rec.u, rec.v, rec.p);
+  color diffuse_color = rec.mat->get_diffuse(rec.u, rec.v, rec.p, tex_query);
   if (ambient.enabled) {
     result = result + rec.mat->ka * ambient.intensity * diffuse_color;
   }
 
-  for (const auto &light_ptr : lights) {
+  for (size_t li = 0; li < lights.size(); li++) {
+    const auto &light_ptr = lights[li];
     vec3 L = light_ptr->get_direction(rec.p);
     double light_dist = light_ptr->get_distance(rec.p);
 
@@ -26,10 +149,10 @@ color calculate_lighting_bvh(const hit_record &rec, const ray &r) {
     // luz. Se o raio atingir qualquer objeto (hit) antes da luz, o ponto está
     // na sombra.
     ray shadow_ray(rec.p + 0.001 * rec.normal, L);
-    hit_record shadow_rec;
 
     // Se houver interseção no intervalo [0.001, dist_luz], é oclusão.
-    if (scene_bvh.hit(shadow_ray, 0.001, light_dist - 0.001, shadow_rec)) {
+    if (shadow_occluded(shadow_ray, light_dist - 0.001, li, light_ptr.get())) {
+      RT_COUNT(occluded_shadow_rays);
       continue; // Ponto sombreado, ignora contribuição difusa/especular desta
                 // luz
     }
@@ -51,11 +174,27 @@ color calculate_lighting_bvh(const hit_record &rec, const ray &r) {
   return result.clamp();
 }
 
-color ray_color_bvh(const ray &r) {
+// Consulta de textura do ponto atingido: a área do pixel projetada na
+// superfície é w x (w / cos), aproximada por um quadrado de mesma área
+// (lado w / sqrt(cos)) para a filtragem isotrópica do mipmap.
+static texture_query make_texture_query(const hit_record &rec, const ray &r,
+                                        int image_width) {
+  texture_query q;
+  double dist = (rec.p - r.origin()).length();
+  double cos_theta = std::fabs(dot(rec.normal, r.direction()));
+  q.footprint = cam.pixel_footprint(dist, image_width) /
+                std::sqrt(std::max(cos_theta, 0.05));
+  q.uv_scale = rec.uv_scale;
+  return q;
+}
+
+color ray_color_bvh(const ray &r, int image_width) {
+  RT_COUNT(primary_rays);
   hit_record rec;
 
   if (scene_bvh.hit(r, 0.001, infinity, rec)) {
-    return calculate_lighting_bvh(rec, r);
+    return calculate_lighting_bvh(rec, r,
+                                  make_texture_query(rec, r, image_width));
   }
 
   vec3 unit_direction = unit_vector(r.direction());
@@ -110,68 +249,251 @@ color ray_color(const ray &r, const hittable_list &world) {
   return sky_color_bottom * (1.0 - t) + sky_color_top * t;
 }
 
+void print_frame_stats(const render_frame_stats &s) {
+  const ray_cost_counters &c = s.rays;
+  double primary = std::max(1LL, c.primary_rays);
+  stringstream ss;
+  ss << fixed << setprecision(1) << "Quadro " << s.width << "x" << s.height
+     << (s.preview ? " (preview)" : "") << ": " << s.frame_ms << " ms, "
+     << s.rays_per_second() / 1e6 << " Mraios/s; " << c.primary_rays
+     << " primarios, " << c.shadow_rays << " de sombra ("
+     << 100.0 * s.occluded_fraction() << "% ocluidos); por raio primario: "
+     << c.node_visits / primary << " nos BVH, " << c.primitive_tests / primary
+     << " testes de primitivas (" << c.triangle_tests / primary
+     << " triangulos), " << c.texture_samples / primary
+     << " amostras de textura";
+  cout << ss.str() << "\n";
+}
+
+// Mapa de calor do custo por pixel (tecla M): em vez da cor, cada pixel
+// mostra quantos nós da BVH, testes de primitivas ou raios de sombra ele
+// custou. O histograma das três métricas é gravado em HEATMAP_CSV_PATH.
+static const char *HEATMAP_CSV_PATH = "heatmap_histograma.csv";
+static vector<ray_cost_counters> pixel_costs;
+
+static long long metric_value(const ray_cost_counters &c, heatmap_metric m) {
+  switch (m) {
+  case heatmap_metric::NODE_VISITS:
+    return c.node_visits;
+  case heatmap_metric::PRIMITIVE_TESTS:
+    return c.primitive_tests;
+  case heatmap_metric::SHADOW_RAYS:
+    return c.shadow_rays;
+  default:
+    return 0;
+  }
+}
+
+const char *heatmap_metric_name(heatmap_metric m) {
+  switch (m) {
+  case heatmap_metric::NODE_VISITS:
+    return "nos da BVH";
+  case heatmap_metric::PRIMITIVE_TESTS:
+    return "testes de primitivas";
+  case heatmap_metric::SHADOW_RAYS:
+    return "raios de sombra";
+  default:
+    return "desligado";
+  }
+}
+
+// Cor falsa para x em [0, 1]: azul, ciano, verde, amarelo, vermelho.
+static color heat_color(double x) {
+  static const color ramp[5] = {color(0.0, 0.0, 0.5), color(0.0, 0.8, 1.0),
+                                color(0.1, 0.9, 0.1), color(1.0, 0.9, 0.0),
+                                color(1.0, 0.0, 0.0)};
+  x = std::clamp(x, 0.0, 1.0) * 4.0;
+  int k = std::min(3, static_cast<int>(x));
+  double f = x - k;
+  return ramp[k] * (1.0 - f) + ramp[k + 1] * f;
+}
+
+static void write_heatmap_histogram() {
+  long long max_value = 0;
+  for (const auto &c : pixel_costs)
+    max_value = std::max(
+        {max_value, c.node_visits, c.primitive_tests, c.shadow_rays});
+
+  vector<long long> nodes(max_value + 1), tests(max_value + 1),
+      shadows(max_value + 1);
+  for (const auto &c : pixel_costs) {
+    nodes[c.node_visits]++;
+    tests[c.primitive_tests]++;
+    shadows[c.shadow_rays]++;
+  }
+
+  ofstream out(HEATMAP_CSV_PATH);
+  if (!out) {
+    cerr << "Erro ao gravar " << HEATMAP_CSV_PATH << "\n";
+    return;
+  }
+  out << "custo,pixels_nos_bvh,pixels_testes_primitivas,pixels_raios_sombra\n";
+  for (long long v = 0; v <= max_value; v++) {
+    if (nodes[v] || tests[v] || shadows[v])
+      out << v << "," << nodes[v] << "," << tests[v] << "," << shadows[v]
+          << "\n";
+  }
+}
+
+// Substitui PixelBuffer pelo mapa de calor da métrica atual. A escala vai
+// até o percentil 99, para que poucos pixels extremos não escureçam o resto.
+static void apply_heatmap() {
+  vector<long long> values(pixel_costs.size());
+  double sum = 0.0;
+  for (size_t k = 0; k < pixel_costs.size(); k++) {
+    values[k] = metric_value(pixel_costs[k], heatmap_mode);
+    sum += values[k];
+  }
+
+  vector<long long> sorted = values;
+  size_t p99_index = sorted.size() * 99 / 100;
+  nth_element(sorted.begin(), sorted.begin() + p99_index, sorted.end());
+  long long p99 = sorted[p99_index];
+  long long max_value = *max_element(values.begin(), values.end());
+  double scale = p99 > 0 ? 1.0 / p99 : 0.0;
+
+  for (size_t k = 0; k < values.size(); k++) {
+    color c = heat_color(values[k] * scale);
+    PixelBuffer[k * 3] = c.r_byte();
+    PixelBuffer[k * 3 + 1] = c.g_byte();
+    PixelBuffer[k * 3 + 2] = c.b_byte();
+  }
+
+  write_heatmap_histogram();
+  cout << "Mapa de calor (" << heatmap_metric_name(heatmap_mode)
+       << " por pixel): media " << sum / values.size() << ", p99 " << p99
+       << ", max " << max_value << "; histograma em " << HEATMAP_CSV_PATH
+       << "\n";
+}
+
 // [Requisito 6] Imagem gerada por Ray Casting com pelo menos 500x500 pixels
 // (Obrigatório) Loop principal de renderização que percorre cada pixel da
 // imagem. IMAGE_WIDTH e IMAGE_HEIGHT definidos em globals.cpp (600x600).
 void render() {
+  TRACE_SCOPE("render (quadro completo)");
   cout << "Renderizando " << IMAGE_WIDTH << "x" << IMAGE_HEIGHT
        << " pixels (OpenMP: " << omp_get_max_threads()
        << " threads, BVH ativado)...\n";
 
-  // Paralelização com OpenMP para performance
-#pragma omp parallel for schedule(dynamic, 8)
-  for (int j = 0; j < IMAGE_HEIGHT; j++) {
-    for (int i = 0; i < IMAGE_WIDTH; i++) {
-      // Coordenadas normalizadas (u, v) variando de 0 a 1 em relação à tela.
-      double u = double(i) / (IMAGE_WIDTH - 1);
-      double v = double(j) / (IMAGE_HEIGHT - 1);
-
-      // [Requisito 3] Projeções (Geração do Raio)
-      // A câmera gera o raio de acordo com o tipo de projeção configurada
-      // (Perspectiva, Ortográfica, etc).
-      ray r = cam.get_ray(u, v);
-
-      // Calcula a cor do pixel (interseção + iluminação + sombra)
-      color pixel_color = ray_color_bvh(r);
+  double start = omp_get_wtime();
+  begin_frame_stats(false, IMAGE_WIDTH, IMAGE_HEIGHT);
+  profiler::trace_scope prepare_scope("preparar sombras pre-calculadas");
+  baked_shadows.prepare(lights, scene_bvh);
+  prepare_scope.finish();
 
-      int idx = (j * IMAGE_WIDTH + i) * 3;
+  bool heatmap = heatmap_mode != heatmap_metric::OFF;
+  if (heatmap)
+    pixel_costs.assign(size_t(IMAGE_WIDTH) * IMAGE_HEIGHT, ray_cost_counters());
 
-      PixelBuffer[idx] = pixel_color.r_byte();
-      PixelBuffer[idx + 1] = pixel_color.g_byte();
-      PixelBuffer[idx + 2] = pixel_color.b_byte();
+  // Paralelização com OpenMP para performance
+#pragma omp parallel
+  {
+    name_render_thread();
+    render_stats::local = ray_cost_counters();
+#pragma omp for schedule(dynamic, 8)
+    for (int j = 0; j < IMAGE_HEIGHT; j++) {
+      // Um evento por linha: mostra a ocupação de cada thread e quantos
+      // raios de sombra a linha lançou.
+      profiler::trace_scope row("linha");
+      long long row_shadow_rays = render_stats::local.shadow_rays;
+
+      for (int i = 0; i < IMAGE_WIDTH; i++) {
+        // Coordenadas normalizadas (u, v) variando de 0 a 1 em relação à tela.
+        double u = double(i) / (IMAGE_WIDTH - 1);
+        double v = double(j) / (IMAGE_HEIGHT - 1);
+
+        // [Requisito 3] Projeções (Geração do Raio)
+        // A câmera gera o raio de acordo com o tipo de projeção configurada
+        // (Perspectiva, Ortográfica, etc).
+        ray r = cam.get_ray(u, v);
+
+        // Calcula a cor do pixel (interseção + iluminação + sombra)
+        ray_cost_counters before = render_stats::local;
+        color pixel_color = ray_color_bvh(r, IMAGE_WIDTH);
+
+        if (heatmap) {
+          const ray_cost_counters &after = render_stats::local;
+          ray_cost_counters &cost = pixel_costs[j * IMAGE_WIDTH + i];
+          cost.node_visits = after.node_visits - before.node_visits;
+          cost.primitive_tests = after.primitive_tests - before.primitive_tests;
+          cost.shadow_rays = after.shadow_rays - before.shadow_rays;
+        }
+
+        int idx = (j * IMAGE_WIDTH + i) * 3;
+
+        PixelBuffer[idx] = pixel_color.r_byte();
+        PixelBuffer[idx + 1] = pixel_color.g_byte();
+        PixelBuffer[idx + 2] = pixel_color.b_byte();
+      }
+
+      row.arg("y", j);
+      row.arg("raios_sombra",
+              double(render_stats::local.shadow_rays - row_shadow_rays));
     }
+
+    merge_ray_counters();
   }
+  frame_stats.frame_ms = (omp_get_wtime() - start) * 1000.0;
 
   cout << "Renderizacao concluida!                    \n";
+  report_shadow_cache_stats();
+  print_frame_stats(frame_stats);
+  if (heatmap)
+    apply_heatmap();
   need_redraw = false;
   frame_cached = true;
 }
 
 void render_preview() {
+  TRACE_SCOPE("render_preview");
   if (!PreviewBuffer) {
     PreviewBuffer = new unsigned char[PREVIEW_WIDTH * PREVIEW_HEIGHT * 3];
   }
 
-#pragma omp parallel for schedule(dynamic, 4)
-  for (int j = 0; j < PREVIEW_HEIGHT; j++) {
-    for (int i = 0; i < PREVIEW_WIDTH; i++) {
-      double u = double(i) / (PREVIEW_WIDTH - 1);
-      double v = double(j) / (PREVIEW_HEIGHT - 1);
-
-      ray r = cam.get_ray(u, v);
-      color pixel_color = ray_color_bvh(r);
-
-      int idx = (j * PREVIEW_WIDTH + i) * 3;
-      PreviewBuffer[idx] = pixel_color.r_byte();
-      PreviewBuffer[idx + 1] = pixel_color.g_byte();
-      PreviewBuffer[idx + 2] = pixel_color.b_byte();
+  double start = omp_get_wtime();
+  begin_frame_stats(true, PREVIEW_WIDTH, PREVIEW_HEIGHT);
+  profiler::trace_scope prepare_scope("preparar sombras pre-calculadas");
+  baked_shadows.prepare(lights, scene_bvh);
+  prepare_scope.finish();
+
+#pragma omp parallel
+  {
+    name_render_thread();
+    render_stats::local = ray_cost_counters();
+#pragma omp for schedule(dynamic, 4)
+    for (int j = 0; j < PREVIEW_HEIGHT; j++) {
+      profiler::trace_scope row("linha (preview)");
+      long long row_shadow_rays = render_stats::local.shadow_rays;
+
+      for (int i = 0; i < PREVIEW_WIDTH; i++) {
+        double u = double(i) / (PREVIEW_WIDTH - 1);
+        double v = double(j) / (PREVIEW_HEIGHT - 1);
+
+        ray r = cam.get_ray(u, v);
+        color pixel_color = ray_color_bvh(r, PREVIEW_WIDTH);
+
+        int idx = (j * PREVIEW_WIDTH + i) * 3;
+        PreviewBuffer[idx] = pixel_color.r_byte();
+        PreviewBuffer[idx + 1] = pixel_color.g_byte();
+        PreviewBuffer[idx + 2] = pixel_color.b_byte();
+      }
+
+      row.arg("y", j);
+      row.arg("raios_sombra",
+              double(render_stats::local.shadow_rays - row_shadow_rays));
     }
+
+    merge_ray_counters();
   }
+  frame_stats.frame_ms = (omp_get_wtime() - start) * 1000.0;
+
+  profiler::counter("raios de sombra", double(frame_stats.rays.shadow_rays));
 }
 
 void upscale_preview() {
   if (!PreviewBuffer)
     return;
+  TRACE_SCOPE("upscale_preview");
 
   double scale_x = double(PREVIEW_WIDTH) / IMAGE_WIDTH;
   double scale_y = double(PREVIEW_HEIGHT) / IMAGE_HEIGHT;
@@ -0,0 +1,600 @@
+#include "../include/scene_loader.h"
+#include "../include/globals.h"
+#include "../include/malha/mesh.h"
+#include "../include/malha/triangle.h"
+#include "../include/object/cone.h"
+#include "../include/object/cylinder.h"
+#include "../include/object/plane.h"
+#include "../include/object/sphere.h"
+#include "../include/profiler.h"
+#include "../include/scene_setup.h"
+#include "../include/textures/mapped_file.h"
+#include "../include/textures/texture_cache.h"
+#include "../include/textures/utils.h"
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+using namespace std;
+
+namespace {
+
+// Lê o arquivo mapeado em memória comando a comando, sem copiar linhas:
+// cada palavra é lida direto do mapeamento para um buffer reaproveitado e os
+// números são convertidos no próprio lugar.
+class scene_parser {
+public:
+  scene_parser(const char *begin, const char *end, const string &path)
+      : cur(begin), end(end), path(path) {}
+
+  bool parse() {
+    while (skip_blank_lines()) {
+      if (!next_word(keyword))
+        return false;
+      if (!command() || !expect_line_end())
+        return false;
+    }
+    if (!stack.empty()) {
+      line = stack.back().line;
+      return fail("bloco sem 'end'");
+    }
+    return true;
+  }
+
+private:
+  enum class node_kind { GROUP, TRANSFORM, OBJECT, PROTOTYPE };
+
+  // Bloco aberto (group, transform, object ou prototype) esperando o 'end'.
+  struct frame {
+    node_kind kind;
+    int line;
+    shared_ptr<hittable_list> children = make_shared<hittable_list>();
+    mat4 forward, inverse;
+    string name;
+    vec3 position, rotation, scale = vec3(1, 1, 1);
+  };
+
+  const char *cur;
+  const char *end;
+  string path;
+  int line = 1;
+
+  string keyword;
+  string word;
+  map<string, shared_ptr<texture>> textures;
+  map<string, shared_ptr<material>> materials;
+  map<string, shared_ptr<hittable>> prototypes;
+  vector<frame> stack;
+
+  bool fail(const string &message) {
+    cerr << "Erro em " << path << ":" << line << ": " << message << "\n";
+    return false;
+  }
+
+  // Espaços e comentário até o fim da linha (sem consumir o '\n').
+  void skip_spaces() {
+    while (cur < end && (*cur == ' ' || *cur == '\t' || *cur == '\r'))
+      cur++;
+    if (cur < end && *cur == '#')
+      while (cur < end && *cur != '\n')
+        cur++;
+  }
+
+  bool at_line_end() {
+    skip_spaces();
+    return cur == end || *cur == '\n';
+  }
+
+  // Avança até o próximo comando; false no fim do arquivo.
+  bool skip_blank_lines() {
+    while (at_line_end()) {
+      if (cur == end)
+        return false;
+      cur++;
+      line++;
+    }
+    return true;
+  }
+
+  bool expect_line_end() {
+    if (!at_line_end())
+      return fail("texto inesperado no fim da linha");
+    return true;
+  }
+
+  // Palavra simples ou texto entre aspas.
+  bool next_word(string &out) {
+    skip_spaces();
+    if (cur == end || *cur == '\n')
+      return fail("faltam argumentos");
+
+    out.clear();
+    if (*cur == '"') {
+      const char *start = ++cur;
+      while (cur < end && *cur != '"' && *cur != '\n')
+        cur++;
+      if (cur == end || *cur != '"')
+        return fail("aspas sem fechamento");
+      out.assign(start, cur++);
+      return true;
+    }
+
+    const char *start = cur;
+    while (cur < end && !isspace(static_cast<unsigned char>(*cur)) &&
+           *cur != '#')
+      cur++;
+    out.assign(start, cur);
+    return true;
+  }
+
+  bool next_number(double &value) {
+    if (at_line_end())
+      return fail("faltam argumentos");
+    // strtod precisa de texto terminado em '\0', que o mapeamento não tem.
+    char buffer[64];
+    size_t n = 0;
+    while (cur + n < end && n + 1 < sizeof(buffer) &&
+           !isspace(static_cast<unsigned char>(cur[n])) && cur[n] != '#') {
+      buffer[n] = cur[n];
+      n++;
+    }
+    buffer[n] = '\0';
+    // Token que não coube no buffer seria lido pela metade.
+    if (cur + n < end && !isspace(static_cast<unsigned char>(cur[n])) &&
+        cur[n] != '#')
+      return fail("numero longo demais '" + string(buffer) + "...'");
+
+    char *parsed_end;
+    value = strtod(buffer, &parsed_end);
+    if (n == 0 || parsed_end != buffer + n)
+      return fail("numero invalido '" + string(buffer) + "'");
+    cur += n;
+    return true;
+  }
+
+  bool next_vec(vec3 &v) {
+    double x, y, z;
+    if (!next_number(x) || !next_number(y) || !next_number(z))
+      return false;
+    v = vec3(x, y, z);
+    return true;
+  }
+
+  bool next_color(color &c) {
+    double r, g, b;
+    if (!next_number(r) || !next_number(g) || !next_number(b))
+      return false;
+    c = color(r, g, b);
+    return true;
+  }
+
+  // Nome opcional no fim da linha de uma primitiva.
+  bool optional_name(string &name, const char *fallback) {
+    if (at_line_end()) {
+      name = fallback;
+      return true;
+    }
+    return next_word(name);
+  }
+
+  bool find_material(shared_ptr<material> &m) {
+    if (!next_word(word))
+      return false;
+    auto it = materials.find(word);
+    if (it == materials.end())
+      return fail("material desconhecido '" + word + "'");
+    m = it->second;
+    return true;
+  }
+
+  // Destino das primitivas: o bloco aberto ou o mundo.
+  void add(shared_ptr<hittable> object) {
+    if (stack.empty())
+      world.add(object);
+    else
+      stack.back().children->add(object);
+  }
+
+  bool command() {
+    const string &k = keyword;
+    if (k == "sphere" || k == "cylinder" || k == "cone" || k == "plane" ||
+        k == "triangle" || k == "box")
+      return primitive();
+    if (k == "group" || k == "transform" || k == "object" ||
+        k == "prototype")
+      return open_block();
+    if (k == "instance")
+      return instance_command();
+    if (k == "end")
+      return close_block();
+    if (k == "material")
+      return material_command();
+    if (k == "texture")
+      return texture_command();
+    if (k == "light")
+      return light_command();
+    if (k == "camera")
+      return next_vec(cam_eye) && next_vec(cam_at) && next_vec(cam_up);
+    if (k == "ambient")
+      return next_color(ambient.intensity);
+    if (k == "sky")
+      return next_color(sky_color_top) && next_color(sky_color_bottom);
+    return fail("comando desconhecido '" + k + "'");
+  }
+
+  bool primitive() {
+    const string &k = keyword;
+    shared_ptr<material> m;
+    if (!find_material(m))
+      return false;
+
+    string name;
+    vec3 a, b, c;
+    double r, h;
+    if (k == "sphere") {
+      if (!next_vec(a) || !next_number(r) || !optional_name(name, "Sphere"))
+        return false;
+      add(make_shared<sphere>(a, r, m, name));
+    } else if (k == "cylinder" || k == "cone") {
+      if (!next_vec(a) || !next_vec(b) || !next_number(r) || !next_number(h) ||
+          !optional_name(name, k == "cone" ? "Cone" : "Cylinder"))
+        return false;
+      if (k == "cone")
+        add(make_shared<cone>(cone::from_base(a, b, r, h, m, name)));
+      else
+        add(make_shared<cylinder>(a, b, r, h, m, name));
+    } else if (k == "plane") {
+      if (!next_vec(a) || !next_vec(b) || !optional_name(name, "Plane"))
+        return false;
+      add(make_shared<plane>(a, b, m, name));
+    } else if (k == "triangle") {
+      if (!next_vec(a) || !next_vec(b) || !next_vec(c) ||
+          !optional_name(name, "Triangle"))
+        return false;
+      add(make_shared<triangle>(a, b, c, m, name));
+    } else {
+      if (!next_vec(a) || !next_vec(b) || !optional_name(name, "Box"))
+        return false;
+      add(make_shared<box_mesh>(a, b, m, name));
+    }
+    return true;
+  }
+
+  // Operações de 'transform', compostas à direita: M = op1 * op2 * ...
+  bool transform_ops(frame &f) {
+    while (!at_line_end()) {
+      if (!next_word(word) || !transform_op(f))
+        return false;
+    }
+    return true;
+  }
+
+  // Uma operação de transform, cujo nome já está em 'word'.
+  bool transform_op(frame &f) {
+    mat4 fwd, inv;
+    vec3 v;
+    double a;
+    if (word == "translate") {
+      if (!next_vec(v))
+        return false;
+      fwd = mat4::translate(v.x(), v.y(), v.z());
+      inv = mat4::translate_inverse(v.x(), v.y(), v.z());
+    } else if (word == "scale") {
+      if (!next_vec(v))
+        return false;
+      if (v.x() == 0.0 || v.y() == 0.0 || v.z() == 0.0)
+        return fail("escala nula");
+      fwd = mat4::scale(v.x(), v.y(), v.z());
+      inv = mat4::scale_inverse(v.x(), v.y(), v.z());
+    } else if (word == "rotate_x" || word == "rotate_y" || word == "rotate_z") {
+      if (!next_number(a))
+        return false;
+      a = degrees_to_radians(a);
+      char axis = word.back();
+      fwd = axis == 'x'   ? mat4::rotate_x(a)
+            : axis == 'y' ? mat4::rotate_y(a)
+                          : mat4::rotate_z(a);
+      inv = axis == 'x'   ? mat4::rotate_x_inverse(a)
+            : axis == 'y' ? mat4::rotate_y_inverse(a)
+                          : mat4::rotate_z_inverse(a);
+    } else if (word == "shear") {
+      double s[6];
+      for (double &value : s)
+        if (!next_number(value))
+          return false;
+      fwd = mat4::shear(s[0], s[1], s[2], s[3], s[4], s[5]);
+      inv = mat4::shear_inverse(s[0], s[1], s[2], s[3], s[4], s[5]);
+    } else {
+      return fail("operacao de transform desconhecida '" + word + "'");
+    }
+    f.forward = f.forward * fwd;
+    f.inverse = inv * f.inverse;
+    return true;
+  }
+
+  // instance <protótipo> [operações de transform] [material <material>]
+  bool instance_command() {
+    if (!next_word(word))
+      return false;
+    auto it = prototypes.find(word);
+    if (it == prototypes.end())
+      return fail("prototipo desconhecido '" + word + "'");
+
+    frame f;
+    shared_ptr<material> m;
+    while (!at_line_end()) {
+      if (!next_word(word))
+        return false;
+      if (word == "material") {
+        if (!find_material(m))
+          return false;
+      } else if (!transform_op(f)) {
+        return false;
+      }
+    }
+
+    auto t = instance_object(it->second, f.forward, f.inverse, m);
+    t->name = it->first;
+    add(t);
+    return true;
+  }
+
+  bool object_args(frame &f) {
+    if (!stack.empty())
+      return fail("'object' so pode aparecer fora de blocos");
+    if (!next_word(f.name))
+      return false;
+
+    bool has_position = false;
+    while (!at_line_end()) {
+      if (!next_word(word))
+        return false;
+      if (word == "pos") {
+        if (!next_vec(f.position))
+          return false;
+        has_position = true;
+      } else if (word == "rot") {
+        if (!next_vec(f.rotation))
+          return false;
+      } else if (word == "scale") {
+        if (!next_vec(f.scale))
+          return false;
+      } else {
+        return fail("atributo de object desconhecido '" + word + "'");
+      }
+    }
+    if (!has_position)
+      return fail("object sem 'pos'");
+    return true;
+  }
+
+  bool open_block() {
+    frame f;
+    f.line = line;
+    if (keyword == "group") {
+      f.kind = node_kind::GROUP;
+    } else if (keyword == "transform") {
+      f.kind = node_kind::TRANSFORM;
+      if (!transform_ops(f))
+        return false;
+    } else if (keyword == "prototype") {
+      f.kind = node_kind::PROTOTYPE;
+      if (!stack.empty())
+        return fail("'prototype' so pode aparecer fora de blocos");
+      if (!next_word(f.name))
+        return false;
+      if (prototypes.count(f.name))
+        return fail("prototipo repetido '" + f.name + "'");
+    } else {
+      f.kind = node_kind::OBJECT;
+      if (!object_args(f))
+        return false;
+    }
+    stack.push_back(std::move(f));
+    return true;
+  }
+
+  bool close_block() {
+    if (stack.empty())
+      return fail("'end' sem bloco aberto");
+    frame f = std::move(stack.back());
+    stack.pop_back();
+
+    if (f.children->objects.empty())
+      return fail("bloco vazio (aberto na linha " + to_string(f.line) + ")");
+
+    // Um único filho dispensa a lista intermediária.
+    shared_ptr<hittable> content = f.children;
+    if (f.children->objects.size() == 1)
+      content = f.children->objects[0];
+
+    switch (f.kind) {
+    case node_kind::GROUP:
+      add(f.children);
+      break;
+    case node_kind::TRANSFORM:
+      add(make_shared<class transform>(content, f.forward, f.inverse));
+      break;
+    case node_kind::OBJECT:
+      register_transformable(content, f.name, f.position, f.rotation,
+                             f.scale);
+      break;
+    case node_kind::PROTOTYPE:
+      prototypes[f.name] = content;
+      break;
+    }
+    return true;
+  }
+
+  bool texture_command() {
+    string name, kind, file;
+    if (!next_word(name) || !next_word(kind))
+      return false;
+
+    shared_ptr<texture> tex;
+    if (kind == "image") {
+      if (!next_word(file))
+        return false;
+      tex = make_shared<image_texture>(file.c_str());
+    } else if (kind == "tiled") {
+      double repeat;
+      if (!next_word(file) || !next_number(repeat))
+        return false;
+      tex = make_shared<tiled_image_texture>(file.c_str(), repeat);
+    } else if (kind == "checker") {
+      color a, b;
+      double scale;
+      if (!next_color(a) || !next_color(b) || !next_number(scale))
+        return false;
+      tex = make_shared<checker_texture>(a, b, scale);
+    } else {
+      return fail("tipo de textura desconhecido '" + kind + "'");
+    }
+    textures[name] = tex;
+    return true;
+  }
+
+  bool material_command() {
+    string name;
+    if (!next_word(name) || !next_word(word))
+      return false;
+
+    auto m = make_shared<material>();
+    m->name = name;
+    if (word == "rgb") {
+      color c;
+      if (!next_color(c))
+        return false;
+      m->kd = make_shared<solid_color>(c);
+    } else if (word == "tex") {
+      if (!next_word(word))
+        return false;
+      auto it = textures.find(word);
+      if (it == textures.end())
+        return fail("textura desconhecida '" + word + "'");
+      m->kd = it->second;
+    } else {
+      return fail("material precisa de 'rgb' ou 'tex'");
+    }
+
+    while (!at_line_end()) {
+      if (!next_word(word))
+        return false;
+      bool ok = true;
+      if (word == "ka")
+        ok = next_color(m->ka);
+      else if (word == "ks")
+        ok = next_color(m->ks);
+      else if (word == "ns")
+        ok = next_number(m->shininess);
+      else if (word == "emission")
+        ok = next_color(m->emission);
+      else if (word == "filter") {
+        if (!next_word(word))
+          return false;
+        if (word == "nearest")
+          m->filter = texture_filter::NEAREST;
+        else if (word == "bilinear")
+          m->filter = texture_filter::BILINEAR;
+        else if (word == "trilinear")
+          m->filter = texture_filter::TRILINEAR;
+        else
+          return fail("filtro desconhecido '" + word + "'");
+      } else
+        return fail("atributo de material desconhecido '" + word + "'");
+      if (!ok)
+        return false;
+    }
+    materials[name] = m;
+    return true;
+  }
+
+  bool light_command() {
+    string kind, name;
+    if (!next_word(kind) || !next_word(name))
+      return false;
+    if (kind != "point" && kind != "spot" && kind != "directional")
+      return fail("tipo de luz desconhecido '" + kind + "'");
+
+    vec3 pos, dir(0, -1, 0), att(1, 0, 0);
+    color intensity(1, 1, 1);
+    double inner = 0.0, outer = 0.0, reach = -1.0;
+    while (!at_line_end()) {
+      if (!next_word(word))
+        return false;
+      bool ok;
+      if (word == "pos")
+        ok = next_vec(pos);
+      else if (word == "dir")
+        ok = next_vec(dir);
+      else if (word == "color")
+        ok = next_color(intensity);
+      else if (word == "att")
+        ok = next_vec(att);
+      else if (word == "inner")
+        ok = next_number(inner);
+      else if (word == "outer")
+        ok = next_number(outer);
+      else if (word == "reach")
+        ok = next_number(reach);
+      else
+        return fail("atributo de luz desconhecido '" + word + "'");
+      if (!ok)
+        return false;
+    }
+
+    shared_ptr<light> l;
+    if (kind == "point") {
+      l = make_shared<point_light>(pos, intensity, att.x(), att.y(), att.z(),
+                                   name);
+    } else if (kind == "spot") {
+      if (outer <= inner)
+        return fail("spot precisa de 'outer' maior que 'inner'");
+      l = make_shared<spot_light>(pos, dir, intensity,
+                                  degrees_to_radians(inner),
+                                  degrees_to_radians(outer), att.x(), att.y(),
+                                  att.z(), name);
+    } else {
+      l = make_shared<directional_light>(dir, intensity, name);
+    }
+    l->reach = reach;
+    // Luzes do arquivo são fixas no cenário, como as de setup_lighting().
+    l->is_static = true;
+    lights.push_back(l);
+    return true;
+  }
+};
+
+} // namespace
+
+bool load_scene_file(const string &path) {
+  PROFILE_SCOPE("load_scene_file");
+
+  mapped_file file;
+  if (!file.open(path.c_str())) {
+    cerr << "Erro ao abrir a cena " << path << "\n";
+    return false;
+  }
+
+  world.clear();
+  lights.clear();
+  firefly_lights.clear();
+  object_states.clear();
+  initial_object_states.clear();
+  object_transforms.clear();
+  mat_metal_ptr = nullptr;
+  sword_light_ptr = nullptr;
+  texture_cache::instance().reset_stats();
+
+  const char *text = reinterpret_cast<const char *>(file.data());
+  scene_parser parser(text, text + file.size(), path);
+  if (!parser.parse())
+    return false;
+
+  scene_file_path = path;
+  setup_camera();
+  cout << "Cena carregada de " << path << ": " << world.objects.size()
+       << " objetos, " << lights.size() << " luzes\n";
+  return true;
+}
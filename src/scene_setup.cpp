@@ -8,6 +8,8 @@
 #include "../include/object/cylinder.h"
 #include "../include/object/plane.h"
 #include "../include/object/sphere.h"
+#include "../include/profiler.h"
+#include "../include/textures/texture_cache.h"
 #include "../include/textures/utils.h"
 #include "../include/transform/transform.h"
 #include "../include/vectors/mat4.h"
@@ -16,6 +18,15 @@
 
 using namespace std;
 
+// Semente da geração procedural da cena. Cada parte (pedras, vegetação,
+// animais...) tira números do seu próprio fluxo, então mudar a quantidade de
+// sorteios de uma parte não altera as outras.
+static const uint64_t SCENE_SEED = 4;
+
+static counter_rng scene_rng(const char *part) {
+  return counter_rng(SCENE_SEED).split(part);
+}
+
 // [Requisito 1.4] Implementação de Transformações Geometricas
 // Esta função aplica as transformações de translação, rotação, escala e
 // cisalhamento nos objetos da cena antes de redesenhar.
@@ -87,9 +98,13 @@ void update_object_transform(const string &name) {
 
   trans_ptr->inverse = Sinv * ShInv * Rinv * Tinv;
 
-  // A normal matrix é a transposta da inversa (para tratamento correto de
-  // normais).
-  trans_ptr->normal_mat = trans_ptr->inverse.transpose();
+  // set_transform reclassifica a matriz (translação, escala uniforme ou afim
+  // geral, ver transform::hit) e recalcula a escala usada no mipmapping.
+  trans_ptr->set_transform(trans_ptr->forward, trans_ptr->inverse);
+
+  // A geometria mudou: a visibilidade pré-calculada das luzes estáticas deixa
+  // de valer.
+  baked_shadows.invalidate();
 
   need_redraw = true; // Sinaliza que a imagem precisa ser renderizada novamente
 }
@@ -139,9 +154,11 @@ void update_sword_light() {
   lights.push_back(sword_light_ptr);
 }
 
-shared_ptr<class transform> register_transformable(
-    shared_ptr<hittable> obj, const string &name, const vec3 &position,
-    const vec3 &rotation = vec3(0, 0, 0), const vec3 &scale = vec3(1, 1, 1)) {
+shared_ptr<class transform> register_transformable(shared_ptr<hittable> obj,
+                                                   const string &name,
+                                                   const vec3 &position,
+                                                   const vec3 &rotation,
+                                                   const vec3 &scale) {
 
   TransformState state;
   state.translation = position;
@@ -215,6 +232,7 @@ void toggle_blade_shine(bool increase) {
 // (Dia/Noite). Instancia luzes pontuais, direcionais, spots e define a luz
 // ambiente.
 void setup_lighting() {
+  PROFILE_SCOPE("setup_lighting");
   lights.clear();
   const double CX = 900.0;
   const double CZ = 900.0;
@@ -306,11 +324,19 @@ void setup_lighting() {
     sky_color_top = color(0.15, 0.2, 0.4);
     sky_color_bottom = color(0.5, 0.4, 0.6);
   }
+
+  // Todas as luzes criadas aqui são fixas no cenário.
+  for (auto &l : lights)
+    l->is_static = true;
 }
 
 void remove_animals() {
 
   world.remove_by_name_prefix("Animal_");
+  // Borboletas e pássaros não usam o prefixo; sem removê-los, cada volta ao
+  // dia somava mais uma cópia deles.
+  world.remove_by_name_prefix("Butterfly_Wings_");
+  world.remove_by_name_prefix("Bird_Brown_");
 
   for (auto &fl : firefly_lights) {
     auto it = std::find(lights.begin(), lights.end(), fl);
@@ -325,6 +351,7 @@ void remove_animals() {
 // [Requisito 1.3.1] Objetos Compostos (Animais)
 // Animais construídos hierarquicamente usando transformações.
 void add_day_animals() {
+  PROFILE_SCOPE("add_day_animals");
   const double CX = 900.0;
   const double CZ = 900.0;
 
@@ -356,24 +383,12 @@ void add_day_animals() {
 
   double butterfly_offsets[][3] = {{30, 40, 20}, {-40, 60, -30}, {20, 50, -50}};
 
-  for (int i = 0; i < 3; i++) {
-
-    double bx = CX + butterfly_offsets[i][0];
-    double by = sword_y + butterfly_offsets[i][1];
-    double bz = CZ + butterfly_offsets[i][2];
-
-    double rot_angle_y = i * 120.0;
-
-    double bank_z = (i % 2 == 0) ? 25.0 : -25.0;
-    double pitch_x = 15.0;
-
-    auto wing_mat = wing_mats[i % 3];
-
-    auto butterfly_parts = make_shared<hittable_list>();
-
+  {
     // [Requisito 1.3.1] Objeto Composto: Borboleta
     // A borboleta é composta por corpo (cilindro) e asas (cubos achatados e
-    // cisalhados).
+    // cisalhados). As três borboletas compartilham a mesma geometria: o corpo
+    // e as antenas entram iguais em todas, e cada par de asas é uma instância
+    // do mesmo protótipo com o material da cor da borboleta.
     auto body_mesh =
         make_shared<cylinder>(point3(0, -2, 0), vec3(0, 1, 0), 0.4, 5,
                               mat_butterfly_body, "Butterfly Body");
@@ -382,30 +397,30 @@ void add_day_animals() {
     // Se mudar para 0, ela voa "reta". Se 90, voa "em pé".
     mat4 body_base_T = mat4::rotate_x(degrees_to_radians(30));
     mat4 body_base_Tinv = mat4::rotate_x_inverse(degrees_to_radians(30));
-    butterfly_parts->add(
-        make_shared<class transform>(body_mesh, body_base_T, body_base_Tinv));
+    auto butterfly_body =
+        make_shared<class transform>(body_mesh, body_base_T, body_base_Tinv);
 
     auto ant_mesh =
         make_shared<cylinder>(point3(0, 0, 0), vec3(0, 1, 0.5), 0.1, 1.5,
                               mat_butterfly_body, "Butterfly Antenna");
-    butterfly_parts->add(
-        translate_object(make_shared<cylinder>(*ant_mesh), -0.3, 2.5, 1));
-    butterfly_parts->add(
-        translate_object(make_shared<cylinder>(*ant_mesh), 0.3, 2.5, 1));
+    auto antenna_L = translate_object(ant_mesh, -0.3, 2.5, 1);
+    auto antenna_R = translate_object(ant_mesh, 0.3, 2.5, 1);
 
     // [Asa da Borboleta]
     // Usamos Box Mesh + Shear (Cisalhamento) para criar polígonos angulares.
     // shear_U (0.5 no eixo X em relação a Y) "puxa" o topo da asa para a
     // direita.
-    auto wing_up_mesh = make_shared<box_mesh>(
-        point3(0, 0, -0.1), point3(5, 4, 0.1), wing_mat, "Butterfly Wing Up");
+    auto wing_up_mesh =
+        make_shared<box_mesh>(point3(0, 0, -0.1), point3(5, 4, 0.1),
+                              mat_wing_red, "Butterfly Wing Up");
     mat4 shear_U = mat4::shear(0.5, 0, 0, 0, 0, 0);
     mat4 shear_Uinv = mat4::shear_inverse(0.5, 0, 0, 0, 0, 0);
 
     // shear_L (-0.2) puxa a parte de baixo para a esquerda, criando o formato
     // de "V".
-    auto wing_low_mesh = make_shared<box_mesh>(
-        point3(0, -3, -0.1), point3(3, 0, 0.1), wing_mat, "Butterfly Wing Low");
+    auto wing_low_mesh =
+        make_shared<box_mesh>(point3(0, -3, -0.1), point3(3, 0, 0.1),
+                              mat_wing_red, "Butterfly Wing Low");
     mat4 shear_L = mat4::shear(-0.2, 0, 0, 0, 0, 0);
     mat4 shear_Linv = mat4::shear_inverse(-0.2, 0, 0, 0, 0, 0);
 
@@ -419,18 +434,16 @@ void add_day_animals() {
     // Alterar este valor simula o "bater" da asa.
     mat4 wing_R_Final = mat4::rotate_z(degrees_to_radians(-30));
     mat4 wing_R_FinalInv = mat4::rotate_z_inverse(degrees_to_radians(-30));
-    butterfly_parts->add(make_shared<class transform>(
-        wing_R_Group, wing_R_Final, wing_R_FinalInv));
 
     auto wing_up_mesh_L =
-        make_shared<box_mesh>(point3(-5, 0, -0.1), point3(0, 4, 0.1), wing_mat,
-                              "Butterfly Wing Up L");
+        make_shared<box_mesh>(point3(-5, 0, -0.1), point3(0, 4, 0.1),
+                              mat_wing_red, "Butterfly Wing Up L");
     mat4 shear_UL = mat4::shear(-0.5, 0, 0, 0, 0, 0);
     mat4 shear_ULinv = mat4::shear_inverse(-0.5, 0, 0, 0, 0, 0);
 
     auto wing_low_mesh_L =
-        make_shared<box_mesh>(point3(-3, -3, -0.1), point3(0, 0, 0.1), wing_mat,
-                              "Butterfly Wing Low L");
+        make_shared<box_mesh>(point3(-3, -3, -0.1), point3(0, 0, 0.1),
+                              mat_wing_red, "Butterfly Wing Low L");
     mat4 shear_LL = mat4::shear(0.2, 0, 0, 0, 0, 0);
     mat4 shear_LLinv = mat4::shear_inverse(0.2, 0, 0, 0, 0, 0);
 
@@ -443,14 +456,38 @@ void add_day_animals() {
     // Rotaciona a asa esquerda em 30 graus.
     mat4 wing_L_Final = mat4::rotate_z(degrees_to_radians(30));
     mat4 wing_L_FinalInv = mat4::rotate_z_inverse(degrees_to_radians(30));
-    butterfly_parts->add(make_shared<class transform>(
-        wing_L_Group, wing_L_Final, wing_L_FinalInv));
-
-    // Randomização de escala para variar tamanhos
-    double sc = 1.0 + random_double(-0.1, 0.1);
-    register_transformable(
-        butterfly_parts, "Butterfly_Wings_" + to_string(i + 1),
-        vec3(bx, by, bz), vec3(pitch_x, rot_angle_y, bank_z), vec3(sc, sc, sc));
+
+    counter_rng butterfly_rng = scene_rng("borboletas");
+    for (int i = 0; i < 3; i++) {
+
+      double bx = CX + butterfly_offsets[i][0];
+      double by = sword_y + butterfly_offsets[i][1];
+      double bz = CZ + butterfly_offsets[i][2];
+
+      double rot_angle_y = i * 120.0;
+
+      double bank_z = (i % 2 == 0) ? 25.0 : -25.0;
+      double pitch_x = 15.0;
+
+      auto wing_mat = wing_mats[i % 3];
+
+      auto butterfly_parts = make_shared<hittable_list>();
+      butterfly_parts->add(butterfly_body);
+      butterfly_parts->add(antenna_L);
+      butterfly_parts->add(antenna_R);
+      butterfly_parts->add(instance_object(wing_R_Group, wing_R_Final,
+                                           wing_R_FinalInv, wing_mat));
+      butterfly_parts->add(instance_object(wing_L_Group, wing_L_Final,
+                                           wing_L_FinalInv, wing_mat));
+
+      // Randomização de escala para variar tamanhos
+      double sc = 1.0 + butterfly_rng.uniform(-0.1, 0.1);
+      register_transformable(butterfly_parts,
+                             "Butterfly_Wings_" + to_string(i + 1),
+                             vec3(bx, by, bz),
+                             vec3(pitch_x, rot_angle_y, bank_z),
+                             vec3(sc, sc, sc));
+    }
   }
 
   // Posições pré-definidas para os coelhos na cena
@@ -460,17 +497,11 @@ void add_day_animals() {
                             {CX + 165, CZ - 165},
                             {834.44, 687.431}};
 
-  for (int i = 0; i < 5; i++) {
-    double rx = rabbit_pos[i][0];
-    double rz = rabbit_pos[i][1];
-
-    double dx = CX - rx;
-    double dz = CZ - rz;
-
-    double angle_rad = atan2(dx, dz);
-
+  {
     // [Requisito 1.3.1] Objeto Composto: Coelho
     // Construção hierárquica usando esferas, cilindros e transformações.
+    // Os cinco coelhos são instâncias do mesmo protótipo: a geometria é
+    // montada uma vez e cada coelho só acrescenta o seu transform.
     auto rabbit_parts = make_shared<hittable_list>();
 
     auto body_mesh =
@@ -566,10 +597,19 @@ void add_day_animals() {
     rabbit_parts->add(
         make_shared<sphere>(point3(0, 8, -9), 3.5, mat_rabbit, "Rabbit Tail"));
 
-    double angle_deg = radians_to_degrees(angle_rad);
-    register_transformable(
-        rabbit_parts, "Animal_Rabbit_Geometric_" + to_string(i + 1),
-        vec3(rx, 0, rz), vec3(0, angle_deg, 0), vec3(1, 1, 1));
+    for (int i = 0; i < 5; i++) {
+      double rx = rabbit_pos[i][0];
+      double rz = rabbit_pos[i][1];
+
+      double dx = CX - rx;
+      double dz = CZ - rz;
+
+      double angle_rad = atan2(dx, dz);
+      double angle_deg = radians_to_degrees(angle_rad);
+      register_transformable(
+          rabbit_parts, "Animal_Rabbit_Geometric_" + to_string(i + 1),
+          vec3(rx, 0, rz), vec3(0, angle_deg, 0), vec3(1, 1, 1));
+    }
   }
 
   auto mat_bird_brown = make_shared<material>(color(0.5, 0.35, 0.2), 0.3, 0.5,
@@ -584,12 +624,8 @@ void add_day_animals() {
                                 {804.178, 200, 845.856},
                                 {1120.82, 230, 947.773}};
 
-  for (int i = 0; i < 4; i++) {
-    double px = bird_positions[i][0];
-    double py = bird_positions[i][1];
-    double pz = bird_positions[i][2];
-    double rot_y = random_double(0, 360);
-
+  counter_rng bird_rng = scene_rng("passaros");
+  {
     auto bird_parts = make_shared<hittable_list>();
 
     // [Requisito 1.3.1] Objeto Composto: Pássaro
@@ -680,10 +716,16 @@ void add_day_animals() {
     bird_parts->add(
         translate_object(make_shared<sphere>(*eye_mesh), 2.1, 3, 8));
 
-    double bank = random_double(-15, 15);
-    register_transformable(bird_parts, "Bird_Brown_" + to_string(i + 1),
-                           vec3(px, py, pz), vec3(0, rot_y, bank),
-                           vec3(1, 1, 1));
+    for (int i = 0; i < 4; i++) {
+      double px = bird_positions[i][0];
+      double py = bird_positions[i][1];
+      double pz = bird_positions[i][2];
+      double rot_y = bird_rng.uniform(0, 360);
+      double bank = bird_rng.uniform(-15, 15);
+      register_transformable(bird_parts, "Bird_Brown_" + to_string(i + 1),
+                             vec3(px, py, pz), vec3(0, rot_y, bank),
+                             vec3(1, 1, 1));
+    }
   }
 
   {
@@ -879,6 +921,7 @@ void add_day_animals() {
 // [Requisito 1.3] Construção de Animais (Lobo e Urso)
 // Valores de translação e rotação definem a pose e estrutura do corpo.
 void add_night_animals() {
+  PROFILE_SCOPE("add_night_animals");
   const double CX = 900.0;
   const double CZ = 900.0;
 
@@ -894,29 +937,31 @@ void add_night_animals() {
   auto mat_bear =
       make_shared<material>(color(0.3, 0.2, 0.15), 0.5, 0.4, 30.0, "Bear Fur");
 
-  for (int i = 0; i < 20; i++) {
-    double firefly_x = CX + random_double(-250, 250);
-    double firefly_y = random_double(30, 150);
-    double firefly_z = CZ + random_double(-250, 250);
-
+  counter_rng firefly_rng = scene_rng("vagalumes");
+  {
     auto firefly_visuals = make_shared<hittable_list>();
     firefly_visuals->add(make_shared<sphere>(
         point3(0, 0, 0), 2, mat_firefly_light, "Animal_Firefly_Light"));
     firefly_visuals->add(make_shared<sphere>(
         point3(1.5, 0.5, 1.5), 1.5, mat_firefly_body, "Animal_Firefly_Body"));
 
-    register_transformable(
-        firefly_visuals, "Animal_Firefly_Geometric_" + to_string(i + 1),
-        vec3(firefly_x, firefly_y, firefly_z), vec3(0, 0, 0), vec3(1, 1, 1));
-
-    double r = random_double(0.3, 0.5);
-    double g = random_double(0.5, 0.7);
-    double b = random_double(0.1, 0.2);
-    auto firefly_light = make_shared<point_light>(
-        point3(firefly_x, firefly_y, firefly_z), color(r, g, b) * 0.8, 1.0,
-        0.05, 0.01, "Point Light - Firefly " + to_string(i + 1));
-    lights.push_back(firefly_light);
-    firefly_lights.push_back(firefly_light);
+    for (int i = 0; i < 20; i++) {
+      double firefly_x = CX + firefly_rng.uniform(-250, 250);
+      double firefly_y = firefly_rng.uniform(30, 150);
+      double firefly_z = CZ + firefly_rng.uniform(-250, 250);
+      register_transformable(
+          firefly_visuals, "Animal_Firefly_Geometric_" + to_string(i + 1),
+          vec3(firefly_x, firefly_y, firefly_z), vec3(0, 0, 0), vec3(1, 1, 1));
+
+      double r = firefly_rng.uniform(0.3, 0.5);
+      double g = firefly_rng.uniform(0.5, 0.7);
+      double b = firefly_rng.uniform(0.1, 0.2);
+      auto firefly_light = make_shared<point_light>(
+          point3(firefly_x, firefly_y, firefly_z), color(r, g, b) * 0.8, 1.0,
+          0.05, 0.01, "Point Light - Firefly " + to_string(i + 1));
+      lights.push_back(firefly_light);
+      firefly_lights.push_back(firefly_light);
+    }
   }
 
   double leader_x = 833.7;
@@ -935,12 +980,7 @@ void add_night_animals() {
   };
   WolfOffset wolves[] = {{0, 0}, {-25, -20}, {25, -20}};
 
-  for (int i = 0; i < 3; i++) {
-
-    double base_x = leader_x + wolves[i].off_x;
-    double base_z = leader_z + wolves[i].off_z;
-    double ly = 12.0;
-
+  {
     auto wolf_parts = make_shared<hittable_list>();
 
     // [Requisito 1.3.1] Objeto Composto: Lobo
@@ -1072,13 +1112,19 @@ void add_night_animals() {
     wolf_parts->add(make_shared<class transform>(tail_mesh, tail_T * tail_R,
                                                  tail_Rinv * tail_Tinv));
 
-    double wolf_angle = atan2(wdx, wdz);
-    double wolf_angle_deg = radians_to_degrees(wolf_angle);
+    for (int i = 0; i < 3; i++) {
 
-    register_transformable(wolf_parts,
-                           "Animal_Wolf_Geometric_" + to_string(i + 1),
-                           vec3(base_x, ly, base_z), vec3(0, wolf_angle_deg, 0),
-                           vec3(1.2, 1.2, 1.2));
+      double base_x = leader_x + wolves[i].off_x;
+      double base_z = leader_z + wolves[i].off_z;
+      double ly = 12.0;
+      double wolf_angle = atan2(wdx, wdz);
+      double wolf_angle_deg = radians_to_degrees(wolf_angle);
+
+      register_transformable(
+          wolf_parts, "Animal_Wolf_Geometric_" + to_string(i + 1),
+          vec3(base_x, ly, base_z), vec3(0, wolf_angle_deg, 0),
+          vec3(1.2, 1.2, 1.2));
+    }
   }
 
   double ux = 973.894;
@@ -1218,10 +1264,7 @@ void add_night_animals() {
                        {ux - urx * torch_dist, uz - urz * torch_dist}};
   double POLE_HEIGHT = 50.0;
 
-  for (int i = 0; i < 2; i++) {
-    double tx = t_pos[i][0];
-    double tz = t_pos[i][1];
-
+  {
     // [Requisito 1.3.1] Objeto Composto: Lanterna/Tocha Medieval
     // Composta por poste (cilindro), jaula (cilindros finos) e chama (cones).
     auto torch_parts = make_shared<hittable_list>();
@@ -1274,19 +1317,23 @@ void add_night_animals() {
     torch_parts->add(translate_object(make_shared<cone>(flame_inner), 0,
                                       cage_start_y + 1, 0));
 
-    auto t_trans = register_transformable(
-        torch_parts, "Animal_Lantern_" + to_string(i + 1), vec3(tx, 0, tz));
-
-    world.add(t_trans);
-
-    // [Requisito 1.5.1] Luz Pontual (Associada à Tocha)
-    // Posicionada dentro da jaula da lanterna.
-    auto torch_light = make_shared<point_light>(
-        point3(tx, cage_start_y + (cage_h * 0.5), tz),
-        color(1.0, 0.6, 0.2) * 2.0, 1.0, 0.002, 0.0001,
-        "Point Light - Bear Torch " + to_string(i + 1));
-    lights.push_back(torch_light);
-    firefly_lights.push_back(torch_light);
+    for (int i = 0; i < 2; i++) {
+      double tx = t_pos[i][0];
+      double tz = t_pos[i][1];
+      auto t_trans = register_transformable(
+          torch_parts, "Animal_Lantern_" + to_string(i + 1), vec3(tx, 0, tz));
+
+      world.add(t_trans);
+
+      // [Requisito 1.5.1] Luz Pontual (Associada à Tocha)
+      // Posicionada dentro da jaula da lanterna.
+      auto torch_light = make_shared<point_light>(
+          point3(tx, cage_start_y + (cage_h * 0.5), tz),
+          color(1.0, 0.6, 0.2) * 2.0, 1.0, 0.002, 0.0001,
+          "Point Light - Bear Torch " + to_string(i + 1));
+      lights.push_back(torch_light);
+      firefly_lights.push_back(torch_light);
+    }
   }
 
   cout << "[Animais] Animais NOTURNOS adicionados (Vagalumes, Alcateia, Urso, "
@@ -1294,6 +1341,12 @@ void add_night_animals() {
 }
 
 void toggle_day_night(bool set_to_night) {
+  PROFILE_SCOPE("toggle_day_night");
+  // Luzes e animais de dia/noite pertencem à cena embutida.
+  if (!scene_file_path.empty()) {
+    cout << "[Ambiente] Cena carregada de arquivo: sem modo dia/noite\n";
+    return;
+  }
   is_night_mode = set_to_night;
   remove_animals();
   setup_lighting();
@@ -1376,21 +1429,21 @@ void setup_camera() {
     // [Requisito 3.1] Projeção Perspectiva (Obrigatório)
     // [Requisito 2.1] Especificação de Câmera (Eye, At, Up)
     // [Requisito 2.2.1] Distância Focal (d = 100.0)
-    cam.setup(cam_eye, cam_at, vec3(0, 1, 0), 100.0, -window_size, window_size,
+    cam.setup(cam_eye, cam_at, cam_up, 100.0, -window_size, window_size,
               -window_size, window_size, ProjectionType::PERSPECTIVE);
     break;
 
   case 1:
     // [Requisito 3.2] Projeção Ortográfica (+ 0.5)
     // Raios paralelos, sem distorção de profundidade.
-    cam.setup(cam_eye, cam_at, vec3(0, 1, 0), 100.0, -window_size, window_size,
+    cam.setup(cam_eye, cam_at, cam_up, 100.0, -window_size, window_size,
               -window_size, window_size, ProjectionType::ORTHOGRAPHIC);
     break;
 
   case 2:
     // [Requisito 3.3] Projeção Oblíqua (+ 0.5)
     // Projeção paralela com cisalhamento (shear) para simular profundidade.
-    cam.setup(cam_eye, cam_at, vec3(0, 1, 0), 100.0, -window_size, window_size,
+    cam.setup(cam_eye, cam_at, cam_up, 100.0, -window_size, window_size,
               -window_size, window_size, ProjectionType::OBLIQUE);
     cam.oblique_angle = 0.5;
     cam.oblique_strength = 0.35;
@@ -1410,13 +1463,22 @@ void setup_camera() {
 // O mundo é definido no primeiro octante.
 // CENTRO DA CENA (Espada) ~ (900, 0, 900).
 // Todos os objetos tem coordenadas positivas (X > 0, Y > 0, Z > 0).
+const char *builtin_scene_build_id() { return __DATE__ " " __TIME__; }
+
 void create_scene() {
+  PROFILE_SCOPE("create_scene");
+  scene_file_path.clear();
   world.clear();
   object_states.clear();
   object_transforms.clear();
+  texture_cache::instance().reset_stats();
 
   setup_lighting();
 
+  // A função é longa e seus trechos compartilham variáveis; cada trecho é
+  // medido por um escopo encerrado explicitamente com finish().
+  profiler::scope section("materiais");
+
   // [Requisito 1.3.2] Materiais (pelo menos quatro materiais distintos)
   // (Obrigatório) [Requisito 1.3.3] Textura Materiais definidos com
   // propriedades de cor difusa (kd), especular (ks), brilho (ns) e reflexão.
@@ -1441,7 +1503,10 @@ void create_scene() {
   auto mat_wall_stone = materials::wall_stone();
   auto mat_leaves = materials::leaves();
   auto mat_lake_rock = materials::lake_rock();
+  texture_cache::instance().report_when_idle();
+  section.finish();
 
+  profiler::scope lake_section("lago, cachoeira e vegetacao");
   const double CX = 900.0;
   const double CZ = 900.0;
 
@@ -1456,12 +1521,13 @@ void create_scene() {
 
   auto lake_rocks_group = make_shared<hittable_list>();
   double current_ang = 0;
+  counter_rng lake_rng = scene_rng("pedras do lago");
   while (current_ang < 2 * pi) {
-    double r = random_double(175, 185);
+    double r = lake_rng.uniform(175, 185);
     double x = r * cos(current_ang);
     double z = r * sin(current_ang);
 
-    double sz = random_double(12, 22);
+    double sz = lake_rng.uniform(12, 22);
     lake_rocks_group->add(make_shared<sphere>(point3(x, -1.0, z), sz,
                                               mat_lake_rock, "Lake Rock"));
 
@@ -1498,23 +1564,27 @@ void create_scene() {
                                     "River Trail"));
   }
 
+  counter_rng splash_rng = scene_rng("respingos");
   for (int i = 0; i < 30; i++) {
-    world.add(make_shared<sphere>(
-        point3(WX + random_double(-50, 50), 10, WZ + random_double(-50, 50)),
-        random_double(8, 20), mat_water, "Splash"));
+    double dx = splash_rng.uniform(-50, 50);
+    double dz = splash_rng.uniform(-50, 50);
+    double radius = splash_rng.uniform(8, 20);
+    world.add(make_shared<sphere>(point3(WX + dx, 10, WZ + dz), radius,
+                                  mat_water, "Splash"));
   }
 
+  counter_rng cliff_rng = scene_rng("paredoes");
   for (int i = 0; i < 65; i++) {
     double angle = -pi / 2 + (pi * i) / 65.0 * 2.6;
     if (angle > pi * 1.3 || angle < -pi * 0.3)
       continue;
 
-    double r = random_double(500, 750);
+    double r = cliff_rng.uniform(500, 750);
     double x = CX + r * cos(angle);
     double z = CZ + r * sin(angle);
 
     shared_ptr<material> mat_wall;
-    double rnd = random_double(0, 1);
+    double rnd = cliff_rng.uniform(0, 1);
     if (rnd > 0.4)
       mat_wall = mat_moss;
     else if (rnd > 0.2)
@@ -1522,8 +1592,8 @@ void create_scene() {
     else
       mat_wall = mat_wall_stone;
 
-    double h = random_double(300, 750);
-    double size = random_double(150, 300);
+    double h = cliff_rng.uniform(300, 750);
+    double size = cliff_rng.uniform(150, 300);
     point3 rock_pos(x, h * 0.5, z);
 
     double dist_to_wf = vec3(x - WX, 0, z - WZ).length();
@@ -1532,23 +1602,24 @@ void create_scene() {
 
     world.add(make_shared<sphere>(rock_pos, size, mat_wall, "Cliff Rock"));
 
-    if (random_double(0, 1) > 0.4) {
+    if (cliff_rng.uniform(0, 1) > 0.4) {
       world.add(make_shared<sphere>(point3(x, h * 0.9, z), size * 0.5, mat_moss,
                                     "Cliff Vegetation"));
     }
   }
 
+  counter_rng upper_cliff_rng = scene_rng("paredoes altos");
   for (int i = 0; i < 50; i++) {
     double angle = -pi / 2 + (pi * i) / 50.0 * 2.6;
     if (angle > pi * 1.3 || angle < -pi * 0.3)
       continue;
 
-    double r = random_double(500, 750);
+    double r = upper_cliff_rng.uniform(500, 750);
     double x = CX + r * cos(angle);
     double z = CZ + r * sin(angle);
 
     shared_ptr<material> mat_wall;
-    double rnd = random_double(0, 1);
+    double rnd = upper_cliff_rng.uniform(0, 1);
     if (rnd > 0.4)
       mat_wall = mat_moss;
     else if (rnd > 0.2)
@@ -1556,8 +1627,8 @@ void create_scene() {
     else
       mat_wall = mat_wall_stone;
 
-    double h = random_double(700, 1100);
-    double size = random_double(180, 350);
+    double h = upper_cliff_rng.uniform(700, 1100);
+    double size = upper_cliff_rng.uniform(180, 350);
     point3 rock_pos(x, h * 0.5, z);
 
     double dist_to_wf = vec3(x - WX, 0, z - WZ).length();
@@ -1569,50 +1640,57 @@ void create_scene() {
     world.add(
         make_shared<sphere>(rock_pos, size, mat_wall, "Upper Cliff Rock"));
 
-    if (random_double(0, 1) > 0.6) {
+    if (upper_cliff_rng.uniform(0, 1) > 0.6) {
       world.add(make_shared<sphere>(point3(x, h * 0.9, z), size * 0.5, mat_moss,
                                     "Upper Vegetation"));
     }
   }
 
   int mushroom_count = 0;
+  counter_rng ground_rng = scene_rng("vegetacao rasteira");
   for (int i = 0; i < 80; i++) {
-    double r = random_double(200, 500);
-    double angle = random_double(0, 2 * pi);
+    double r = ground_rng.uniform(200, 500);
+    double angle = ground_rng.uniform(0, 2 * pi);
     double x = CX + r * cos(angle);
     double z = CZ + r * sin(angle);
 
     if (vec3(x - WX, 0, z - WZ).length() < 100)
       continue;
 
-    double type = random_double(0, 1);
+    double type = ground_rng.uniform(0, 1);
     if (type < 0.3) {
 
       auto mushroom_parts = make_shared<hittable_list>();
-      double stem_height = random_double(5, 15);
-      mushroom_parts->add(make_shared<cylinder>(
-          point3(0, 0, 0), vec3(0, 1, 0), random_double(1, 3), stem_height,
-          mat_stem, "Mushroom Stem"));
+      double stem_height = ground_rng.uniform(5, 15);
+      double stem_radius = ground_rng.uniform(1, 3);
+      double cap_radius = ground_rng.uniform(4, 8);
+      mushroom_parts->add(make_shared<cylinder>(point3(0, 0, 0), vec3(0, 1, 0),
+                                                stem_radius, stem_height,
+                                                mat_stem, "Mushroom Stem"));
       mushroom_parts->add(make_shared<sphere>(point3(0, stem_height, 0),
-                                              random_double(4, 8), mat_cap,
+                                              cap_radius, mat_cap,
                                               "Mushroom Cap"));
       string mush_name = "Mushroom " + to_string(++mushroom_count);
       register_transformable(mushroom_parts, mush_name, vec3(x, 0, z));
     } else if (type < 0.7) {
-      world.add(make_shared<sphere>(point3(x, 0, z), random_double(10, 25),
-                                    mat_moss, "Bush"));
+      double radius = ground_rng.uniform(10, 25);
+      world.add(
+          make_shared<sphere>(point3(x, 0, z), radius, mat_moss, "Bush"));
     } else {
-      world.add(make_shared<cylinder>(
-          point3(x, 0, z),
-          vec3(random_double(-0.2, 0.2), 1, random_double(-0.2, 0.2)),
-          random_double(2, 5), random_double(10, 20), mat_moss, "Grass Tufo"));
+      double tilt_x = ground_rng.uniform(-0.2, 0.2);
+      double tilt_z = ground_rng.uniform(-0.2, 0.2);
+      double radius = ground_rng.uniform(2, 5);
+      double height = ground_rng.uniform(10, 20);
+      world.add(make_shared<cylinder>(point3(x, 0, z), vec3(tilt_x, 1, tilt_z),
+                                      radius, height, mat_moss, "Grass Tufo"));
     }
   }
 
   int colony_count = 0;
+  counter_rng colony_rng = scene_rng("colonias de cogumelos");
   for (int i = 0; i < 15; i++) {
-    double r_colony = random_double(200, 480);
-    double ang_colony = random_double(0, 2 * pi);
+    double r_colony = colony_rng.uniform(200, 480);
+    double ang_colony = colony_rng.uniform(0, 2 * pi);
     double colony_x = CX + r_colony * cos(ang_colony);
     double colony_z = CZ + r_colony * sin(ang_colony);
 
@@ -1620,19 +1698,22 @@ void create_scene() {
       continue;
 
     auto colony_parts = make_shared<hittable_list>();
-    int num_mush = (int)random_double(3, 8);
+    int num_mush = (int)colony_rng.uniform(3, 8);
     for (int k = 0; k < num_mush; k++) {
-      double mr = random_double(5, 15);
-      double mang = random_double(0, 2 * pi);
+      double mr = colony_rng.uniform(5, 15);
+      double mang = colony_rng.uniform(0, 2 * pi);
       double mx = mr * cos(mang);
       double mz = mr * sin(mang);
-      double stem_h = random_double(3, 8);
+      double stem_h = colony_rng.uniform(3, 8);
+
+      double stem_r = colony_rng.uniform(0.5, 1.5);
+      double cap_r = colony_rng.uniform(2, 5);
 
       colony_parts->add(make_shared<cylinder>(point3(mx, 0, mz), vec3(0, 1, 0),
-                                              random_double(0.5, 1.5), stem_h,
-                                              mat_stem, "Colony Stem"));
-      colony_parts->add(make_shared<sphere>(
-          point3(mx, stem_h, mz), random_double(2, 5), mat_cap, "Colony Cap"));
+                                              stem_r, stem_h, mat_stem,
+                                              "Colony Stem"));
+      colony_parts->add(make_shared<sphere>(point3(mx, stem_h, mz), cap_r,
+                                            mat_cap, "Colony Cap"));
     }
     string colony_name = "Colony " + to_string(++colony_count);
     register_transformable(colony_parts, colony_name,
@@ -1643,6 +1724,7 @@ void create_scene() {
                              point3(CX + 300, 0, CZ + 80)};
   string tree_names[] = {"Arvore 1", "Arvore 2"};
 
+  counter_rng tree_rng = scene_rng("arvores");
   for (int tree_idx = 0; tree_idx < 2; tree_idx++) {
     point3 base_pos = tree_positions[tree_idx];
     auto tree_parts = make_shared<hittable_list>();
@@ -1653,8 +1735,8 @@ void create_scene() {
                                           400, mat_wood, "Tree Trunk"));
 
     for (int k = 0; k < 8; k++) {
-      double h = random_double(150, 350);
-      double ang = random_double(0, 2 * pi);
+      double h = tree_rng.uniform(150, 350);
+      double ang = tree_rng.uniform(0, 2 * pi);
       vec3 branch_dir = vec3(cos(ang), 0.5, sin(ang));
       point3 branch_start = point3(0, h, 0);
 
@@ -1663,8 +1745,9 @@ void create_scene() {
                                             mat_wood, "Tree Branch"));
       // Folhas (Esfera)
       point3 leaf_center = branch_start + branch_dir * 100.0;
-      tree_parts->add(make_shared<sphere>(leaf_center, random_double(40, 70),
-                                          mat_leaves, "Tree Leaves"));
+      double leaf_radius = tree_rng.uniform(40, 70);
+      tree_parts->add(make_shared<sphere>(leaf_center, leaf_radius, mat_leaves,
+                                          "Tree Leaves"));
     }
 
     register_transformable(tree_parts, tree_names[tree_idx],
@@ -1675,6 +1758,9 @@ void create_scene() {
 
   auto rock_parts = make_shared<hittable_list>();
 
+  lake_section.finish();
+
+  profiler::scope rock_section("rocha e espada");
   // [Requisito 1.3.1] Objeto Primitivo: Esfera (Núcleo da Montanha)
   // Base para a rocha principal onde a espada está encravada.
   auto mountain_core =
@@ -1818,6 +1904,9 @@ void create_scene() {
                                                  0.08, 4.0, "Ancient Stone");
 
   auto pillar1_parts = make_shared<hittable_list>();
+  rock_section.finish();
+
+  profiler::scope pillar_section("pilares e tochas");
   // [Pilar em Ruínas com Cisalhamento]
   // Usa cisalhamento (shear) para simular o colapso/inclinação da estrutura.
   auto pillar1_cyl =
@@ -1956,6 +2045,9 @@ void create_scene() {
   object_states[torch_name] = torch_state;
   object_transforms[torch_name] = torch_transform;
 
+  pillar_section.finish();
+
+  profiler::scope mirror_section("reflexoes");
   // [Requisito 1.4.5] Reflexão (Espelho) em Relação a um Plano Arbitrário
   // A função reflect_object cria uma cópia espelhada do objeto em relação a um
   // plano (ponto, normal). Aqui, espelhamos partes da espada em relação à
@@ -1986,6 +2078,7 @@ void create_scene() {
   auto splash_mirrored =
       reflect_object(waterfall_splash, point3(WX, 2.0, WZ), vec3(0, 1, 0));
   world.add(splash_mirrored);
+  mirror_section.finish();
 
   setup_camera();
 
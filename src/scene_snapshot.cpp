@@ -0,0 +1,1055 @@
+#include "../include/scene_snapshot.h"
+#include "../include/globals.h"
+#include "../include/malha/mesh.h"
+#include "../include/malha/triangle.h"
+#include "../include/object/cone.h"
+#include "../include/object/cylinder.h"
+#include "../include/object/plane.h"
+#include "../include/object/sphere.h"
+#include "../include/scene_setup.h"
+#include "../include/textures/mapped_file.h"
+#include "../include/textures/texture_cache.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+const char snapshot_magic[8] = {'C', 'E', 'N', 'A', 'B', 'I', 'N', '\0'};
+const uint32_t snapshot_version = 3;
+// Gravado como inteiro: em máquina de outra ordem de bytes é lido trocado.
+const uint32_t endian_mark = 0x01020304u;
+const int32_t NONE = -1;
+
+enum section_id {
+  STRINGS,   // char, textos terminados em '\0'
+  PARAMS,    // double, parâmetros das primitivas e matrizes
+  TEXTURES,  // texture_record
+  MATERIALS, // material_record
+  NODES,     // node_record, filhos sempre antes dos pais
+  CHILDREN,  // uint32_t, índices de nós
+  WORLD,     // uint32_t, world.objects na ordem original
+  LIGHTS,    // light_record
+  REGISTRY,  // registry_record
+  BVH,       // bvh_record, filhos sempre antes dos pais
+  UNBOUNDED, // uint32_t, scene_bvh.unbounded_objects
+  SECTION_COUNT
+};
+
+struct section_entry {
+  uint64_t offset;
+  uint64_t count;
+};
+
+struct snapshot_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;
+  uint64_t file_size;
+  section_entry sections[SECTION_COUNT];
+  double eye[3], at[3], up[3];
+  double ambient[3], sky_top[3], sky_bottom[3];
+  int32_t metal_material; // mat_metal_ptr
+  int32_t bvh_root;
+  uint32_t night_mode;
+  uint32_t blade_shine;
+  uint32_t scene_file; // scene_file_path, em STRINGS ("" = cena embutida)
+  // Origem da cena, conferida na leitura: a compilação de create_scene()
+  // (builtin_scene_build_id(), em STRINGS) ou a data e o tamanho do .cena.
+  uint32_t builtin_build;
+  int64_t source_mtime;
+  int64_t source_size;
+};
+
+enum class texture_kind : uint32_t {
+  SOLID,
+  CHECKER,
+  STONE,
+  METAL,
+  IMAGE,
+  TILED
+};
+
+struct texture_record {
+  texture_kind kind;
+  uint32_t path; // IMAGE e TILED
+  double a[3], b[3];
+  double scale;
+};
+
+struct material_record {
+  int32_t kd;
+  uint32_t name;
+  uint32_t filter;
+  uint32_t reserved;
+  double ka[3], ks[3], emission[3];
+  double shininess;
+};
+
+enum class node_kind : uint32_t {
+  SPHERE,    // centro, raio
+  CYLINDER,  // base, eixo, raio, altura
+  CONE,      // ápice, eixo, ângulo, altura
+  PLANE,     // ponto, normal
+  TRIANGLE,  // v0, v1, v2
+  BOX,       // mínimo, máximo
+  BLADE,     // faces (triângulos) em CHILDREN
+  LIST,      // objetos em CHILDREN
+  TRANSFORM, // forward e inverse (32 doubles), objeto em CHILDREN;
+             // o material é o material_override
+};
+
+const uint32_t param_count[] = {4, 8, 8, 6, 9, 6, 0, 0, 32};
+
+struct node_record {
+  node_kind kind;
+  int32_t material;
+  uint32_t name;
+  uint32_t child_count;
+  uint64_t first_param;
+  uint64_t first_child;
+};
+
+enum class light_kind : uint32_t { POINT, SPOT, DIRECTIONAL };
+enum light_flag : uint32_t {
+  LIGHT_ENABLED = 1,
+  LIGHT_STATIC = 2,
+  LIGHT_FIREFLY = 4,
+  LIGHT_SWORD = 8
+};
+
+struct light_record {
+  light_kind kind;
+  uint32_t name;
+  uint32_t flags;
+  uint32_t reserved;
+  double intensity[3], position[3], direction[3], target[3], attenuation[3];
+  double inner, outer, reach;
+};
+
+struct registry_record {
+  uint32_t name;
+  int32_t transform; // nó TRANSFORM de object_transforms
+  uint32_t has_state;
+  uint32_t has_initial;
+  double state[15], initial[15];
+};
+
+// left/right >= 0: outro bvh_record; < 0: nó -(i + 1) da cena.
+struct bvh_record {
+  double min[3], max[3];
+  int32_t left, right;
+  uint32_t axis; // eixo da divisão (ordem dos filhos no percurso)
+  uint32_t reserved;
+};
+
+void put3(double *out, const vec3 &v) {
+  out[0] = v.x();
+  out[1] = v.y();
+  out[2] = v.z();
+}
+
+void put3(double *out, const color &c) {
+  out[0] = c.r;
+  out[1] = c.g;
+  out[2] = c.b;
+}
+
+vec3 get_vec(const double *in) { return vec3(in[0], in[1], in[2]); }
+color get_color(const double *in) { return color(in[0], in[1], in[2]); }
+
+void put_state(double *out, const TransformState &s) {
+  put3(out, s.scale);
+  put3(out + 3, s.rotation);
+  put3(out + 6, s.translation);
+  for (int i = 0; i < 6; i++)
+    out[9 + i] = s.shear[i];
+}
+
+TransformState get_state(const double *in) {
+  TransformState s;
+  s.scale = get_vec(in);
+  s.rotation = get_vec(in + 3);
+  s.translation = get_vec(in + 6);
+  for (int i = 0; i < 6; i++)
+    s.shear[i] = in[9 + i];
+  return s;
+}
+
+// Percorre a cena e monta as tabelas. Objetos compartilhados (o mesmo
+// ponteiro em vários pais) viram um único registro.
+class snapshot_writer {
+public:
+  bool collect() {
+    for (const auto &obj : world.objects) {
+      int32_t i = node_index(obj);
+      if (i < 0)
+        return false;
+      world_nodes.push_back(static_cast<uint32_t>(i));
+    }
+
+    for (const auto &l : lights)
+      if (!add_light(l))
+        return false;
+
+    if (!collect_registry())
+      return false;
+
+    bvh_root = NONE;
+    if (scene_bvh.bvh_root) {
+      bvh_root = bvh_index(scene_bvh.bvh_root);
+      if (bvh_root < 0)
+        return false;
+    }
+    for (const auto &obj : scene_bvh.unbounded_objects) {
+      int32_t i = node_index(obj);
+      if (i < 0)
+        return false;
+      unbounded.push_back(static_cast<uint32_t>(i));
+    }
+    return true;
+  }
+
+  bool save(const string &path) {
+    snapshot_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, snapshot_magic, sizeof(h.magic));
+    h.version = snapshot_version;
+    h.endian = endian_mark;
+    put3(h.eye, cam_eye);
+    put3(h.at, cam_at);
+    put3(h.up, cam_up);
+    put3(h.ambient, ambient.intensity);
+    put3(h.sky_top, sky_color_top);
+    put3(h.sky_bottom, sky_color_bottom);
+    h.metal_material = mat_metal_ptr ? material_index(mat_metal_ptr) : NONE;
+    h.bvh_root = bvh_root;
+    h.night_mode = is_night_mode ? 1 : 0;
+    h.blade_shine = blade_shine_enabled ? 1 : 0;
+    h.scene_file = string_index(scene_file_path);
+    h.builtin_build = string_index(
+        scene_file_path.empty() ? builtin_scene_build_id() : "");
+    mip_image::source_stamp stamp;
+    if (!scene_file_path.empty()) {
+      // Sem o arquivo não há como conferir depois: o snapshot nunca vale.
+      if (!texture_cache::stat_source(scene_file_path, stamp))
+        stamp.mtime = stamp.size = -1;
+    }
+    h.source_mtime = stamp.mtime;
+    h.source_size = stamp.size;
+
+    // As seções são calculadas antes de gravar para que o cabeçalho já saia
+    // completo; todas começam em múltiplo de 8.
+    const section_data sections[SECTION_COUNT] = {
+        section(strings),     section(params),   section(textures),
+        section(materials),   section(nodes),    section(children),
+        section(world_nodes), section(light_records), section(registry),
+        section(bvh),         section(unbounded)};
+
+    uint64_t offset = sizeof(h);
+    for (int s = 0; s < SECTION_COUNT; s++) {
+      h.sections[s].offset = offset;
+      h.sections[s].count = sections[s].count;
+      offset = align(offset + sections[s].bytes());
+    }
+    h.file_size = offset;
+
+    string tmp_path = path + ".tmp";
+    FILE *f = fopen(tmp_path.c_str(), "wb");
+    if (!f)
+      return false;
+
+    static const char zeros[8] = {};
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (const section_data &sec : sections) {
+      size_t bytes = sec.bytes();
+      size_t padding = align(bytes) - bytes;
+      ok = ok && fwrite(sec.data, 1, bytes, f) == bytes;
+      ok = ok && fwrite(zeros, 1, padding, f) == padding;
+    }
+    ok = (fclose(f) == 0) && ok;
+
+    // Mesmo cuidado do cache de texturas: nunca deixar um snapshot pela
+    // metade no caminho final.
+    remove(path.c_str());
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+      remove(tmp_path.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  size_t node_total() const { return nodes.size(); }
+  size_t bvh_total() const { return bvh.size(); }
+
+private:
+  vector<char> strings;
+  vector<double> params;
+  vector<texture_record> textures;
+  vector<material_record> materials;
+  vector<node_record> nodes;
+  vector<uint32_t> children;
+  vector<uint32_t> world_nodes;
+  vector<light_record> light_records;
+  vector<registry_record> registry;
+  vector<bvh_record> bvh;
+  vector<uint32_t> unbounded;
+  int32_t bvh_root = NONE;
+
+  unordered_map<string, uint32_t> string_ids;
+  unordered_map<const texture *, int32_t> texture_ids;
+  unordered_map<const material *, int32_t> material_ids;
+  unordered_map<const hittable *, int32_t> node_ids;
+
+  struct section_data {
+    const void *data;
+    size_t count;
+    size_t element_size;
+    size_t bytes() const { return count * element_size; }
+  };
+
+  template <typename T> static section_data section(const vector<T> &v) {
+    return {v.data(), v.size(), sizeof(T)};
+  }
+
+  static uint64_t align(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+  uint32_t string_index(const string &s) {
+    auto it = string_ids.find(s);
+    if (it != string_ids.end())
+      return it->second;
+    uint32_t id = static_cast<uint32_t>(strings.size());
+    strings.insert(strings.end(), s.begin(), s.end());
+    strings.push_back('\0');
+    string_ids[s] = id;
+    return id;
+  }
+
+  int32_t texture_index(const shared_ptr<texture> &t) {
+    auto it = texture_ids.find(t.get());
+    if (it != texture_ids.end())
+      return it->second;
+
+    texture_record r;
+    memset(&r, 0, sizeof(r));
+    if (auto s = dynamic_pointer_cast<solid_color>(t)) {
+      r.kind = texture_kind::SOLID;
+      put3(r.a, s->c);
+    } else if (auto c = dynamic_pointer_cast<checker_texture>(t)) {
+      auto even = dynamic_pointer_cast<solid_color>(c->even);
+      auto odd = dynamic_pointer_cast<solid_color>(c->odd);
+      if (!even || !odd)
+        return unsupported("textura xadrez sem cores solidas");
+      r.kind = texture_kind::CHECKER;
+      put3(r.a, even->c);
+      put3(r.b, odd->c);
+      r.scale = c->scale;
+    } else if (auto s = dynamic_pointer_cast<stone_texture>(t)) {
+      r.kind = texture_kind::STONE;
+      put3(r.a, s->base_color);
+      r.scale = s->noise_scale;
+    } else if (auto m = dynamic_pointer_cast<metal_texture>(t)) {
+      r.kind = texture_kind::METAL;
+      put3(r.a, m->base_color);
+    } else if (auto i = dynamic_pointer_cast<image_texture>(t)) {
+      r.kind = texture_kind::IMAGE;
+      r.path = string_index(i->path());
+    } else if (auto i = dynamic_pointer_cast<tiled_image_texture>(t)) {
+      r.kind = texture_kind::TILED;
+      r.path = string_index(i->path());
+      r.scale = i->tile_scale();
+    } else {
+      return unsupported("tipo de textura desconhecido");
+    }
+
+    int32_t id = static_cast<int32_t>(textures.size());
+    textures.push_back(r);
+    texture_ids[t.get()] = id;
+    return id;
+  }
+
+  int32_t material_index(const shared_ptr<material> &m) {
+    if (!m)
+      return NONE;
+    auto it = material_ids.find(m.get());
+    if (it != material_ids.end())
+      return it->second;
+
+    material_record r;
+    memset(&r, 0, sizeof(r));
+    r.kd = m->kd ? texture_index(m->kd) : NONE;
+    if (m->kd && r.kd < 0)
+      return INT32_MIN;
+    r.name = string_index(m->name);
+    r.filter = static_cast<uint32_t>(m->filter);
+    put3(r.ka, m->ka);
+    put3(r.ks, m->ks);
+    put3(r.emission, m->emission);
+    r.shininess = m->shininess;
+
+    int32_t id = static_cast<int32_t>(materials.size());
+    materials.push_back(r);
+    material_ids[m.get()] = id;
+    return id;
+  }
+
+  int32_t unsupported(const string &what) {
+    cerr << "Snapshot: " << what << "\n";
+    return INT32_MIN;
+  }
+
+  // Índice do nó (gravando-o, e antes os filhos, na primeira visita).
+  // Negativo em caso de erro.
+  int32_t node_index(const shared_ptr<hittable> &obj) {
+    auto it = node_ids.find(obj.get());
+    if (it != node_ids.end())
+      return it->second;
+
+    node_record r;
+    memset(&r, 0, sizeof(r));
+    r.first_param = params.size();
+    vector<uint32_t> kids;
+    shared_ptr<material> mat;
+    string name;
+
+    auto add_children = [&](const vector<shared_ptr<hittable>> &objects) {
+      for (const auto &child : objects) {
+        int32_t i = node_index(child);
+        if (i < 0)
+          return false;
+        kids.push_back(static_cast<uint32_t>(i));
+      }
+      return true;
+    };
+
+    if (auto s = dynamic_pointer_cast<sphere>(obj)) {
+      r.kind = node_kind::SPHERE;
+      push(s->center);
+      params.push_back(s->radius);
+      mat = s->mat;
+      name = s->name;
+    } else if (auto c = dynamic_pointer_cast<cylinder>(obj)) {
+      r.kind = node_kind::CYLINDER;
+      push(c->base_center);
+      push(c->axis);
+      params.push_back(c->radius);
+      params.push_back(c->height);
+      mat = c->mat;
+      name = c->name;
+    } else if (auto c = dynamic_pointer_cast<cone>(obj)) {
+      r.kind = node_kind::CONE;
+      push(c->apex);
+      push(c->axis);
+      params.push_back(c->angle);
+      params.push_back(c->height);
+      mat = c->mat;
+      name = c->name;
+    } else if (auto p = dynamic_pointer_cast<plane>(obj)) {
+      r.kind = node_kind::PLANE;
+      push(p->point);
+      push(p->normal);
+      mat = p->mat;
+      name = p->name;
+    } else if (auto t = dynamic_pointer_cast<triangle>(obj)) {
+      r.kind = node_kind::TRIANGLE;
+      push(t->v0);
+      push(t->v1);
+      push(t->v2);
+      mat = t->mat;
+      name = t->name;
+    } else if (auto b = dynamic_pointer_cast<box_mesh>(obj)) {
+      r.kind = node_kind::BOX;
+      push(b->min_corner);
+      push(b->max_corner);
+      mat = b->mat;
+      name = b->name;
+    } else if (auto b = dynamic_pointer_cast<blade_mesh>(obj)) {
+      r.kind = node_kind::BLADE;
+      if (!add_children(b->faces.objects))
+        return INT32_MIN;
+      mat = b->mat;
+      name = b->name;
+    } else if (auto l = dynamic_pointer_cast<hittable_list>(obj)) {
+      r.kind = node_kind::LIST;
+      if (!add_children(l->objects))
+        return INT32_MIN;
+    } else if (auto t = dynamic_pointer_cast<class transform>(obj)) {
+      r.kind = node_kind::TRANSFORM;
+      int32_t child = node_index(t->object);
+      if (child < 0)
+        return INT32_MIN;
+      kids.push_back(static_cast<uint32_t>(child));
+      // Os filhos podem ter gravado parâmetros no meio do caminho.
+      r.first_param = params.size();
+      for (const mat4 *m : {&t->forward, &t->inverse})
+        for (int i = 0; i < 4; i++)
+          for (int j = 0; j < 4; j++)
+            params.push_back(m->m[i][j]);
+      mat = t->material_override;
+      name = t->name;
+    } else {
+      return unsupported("objeto de tipo desconhecido '" + obj->get_name() +
+                         "'");
+    }
+
+    r.material = material_index(mat);
+    if (r.material == INT32_MIN)
+      return INT32_MIN;
+    r.name = string_index(name);
+    r.child_count = static_cast<uint32_t>(kids.size());
+    r.first_child = children.size();
+    children.insert(children.end(), kids.begin(), kids.end());
+
+    int32_t id = static_cast<int32_t>(nodes.size());
+    nodes.push_back(r);
+    node_ids[obj.get()] = id;
+    return id;
+  }
+
+  void push(const vec3 &v) {
+    params.push_back(v.x());
+    params.push_back(v.y());
+    params.push_back(v.z());
+  }
+
+  bool add_light(const shared_ptr<light> &l) {
+    light_record r;
+    memset(&r, 0, sizeof(r));
+    r.name = string_index(l->name);
+    put3(r.intensity, l->intensity);
+    r.reach = l->reach;
+    r.flags = (l->enabled ? LIGHT_ENABLED : 0) |
+              (l->is_static ? LIGHT_STATIC : 0) |
+              (l == sword_light_ptr ? LIGHT_SWORD : 0);
+    for (const auto &fl : firefly_lights)
+      if (fl == l)
+        r.flags |= LIGHT_FIREFLY;
+
+    if (auto p = dynamic_pointer_cast<point_light>(l)) {
+      r.kind = light_kind::POINT;
+      put3(r.position, p->position);
+      put3(r.attenuation, vec3(p->c1, p->c2, p->c3));
+    } else if (auto s = dynamic_pointer_cast<spot_light>(l)) {
+      r.kind = light_kind::SPOT;
+      put3(r.position, s->position);
+      put3(r.direction, s->direction);
+      put3(r.attenuation, vec3(s->c1, s->c2, s->c3));
+      r.inner = s->inner_angle;
+      r.outer = s->outer_angle;
+    } else if (auto d = dynamic_pointer_cast<directional_light>(l)) {
+      r.kind = light_kind::DIRECTIONAL;
+      put3(r.position, d->position);
+      put3(r.direction, d->direction);
+      put3(r.target, d->target);
+    } else {
+      unsupported("tipo de luz desconhecido");
+      return false;
+    }
+    light_records.push_back(r);
+    return true;
+  }
+
+  bool collect_registry() {
+    set<string> names;
+    for (const auto &entry : object_states)
+      names.insert(entry.first);
+    for (const auto &entry : initial_object_states)
+      names.insert(entry.first);
+    for (const auto &entry : object_transforms)
+      names.insert(entry.first);
+
+    for (const string &name : names) {
+      registry_record r;
+      memset(&r, 0, sizeof(r));
+      r.name = string_index(name);
+      r.transform = NONE;
+      auto t = object_transforms.find(name);
+      if (t != object_transforms.end() && t->second &&
+          (r.transform = node_index(t->second)) < 0)
+        return false;
+      auto s = object_states.find(name);
+      if ((r.has_state = s != object_states.end()))
+        put_state(r.state, s->second);
+      auto i = initial_object_states.find(name);
+      if ((r.has_initial = i != initial_object_states.end()))
+        put_state(r.initial, i->second);
+      registry.push_back(r);
+    }
+    return true;
+  }
+
+  // INT32_MIN em caso de erro (os demais negativos são referências a nós).
+  int32_t bvh_index(const shared_ptr<hittable> &obj) {
+    auto node = dynamic_pointer_cast<bvh_node>(obj);
+    if (!node) {
+      int32_t i = node_index(obj);
+      return i < 0 ? INT32_MIN : -(i + 1);
+    }
+
+    bvh_record r;
+    memset(&r, 0, sizeof(r));
+    r.left = bvh_index(node->left);
+    if (r.left == INT32_MIN)
+      return INT32_MIN;
+    r.right = node->right == node->left ? r.left : bvh_index(node->right);
+    if (r.right == INT32_MIN)
+      return INT32_MIN;
+    put3(r.min, node->box.minimum);
+    put3(r.max, node->box.maximum);
+    r.axis = static_cast<uint32_t>(node->axis);
+
+    int32_t id = static_cast<int32_t>(bvh.size());
+    bvh.push_back(r);
+    return id;
+  }
+};
+
+// Lê as tabelas direto do arquivo mapeado. Nada é aplicado às variáveis
+// globais antes de o arquivo inteiro ser validado e reconstruído.
+class snapshot_reader {
+public:
+  // 'scene_path' é a cena pedida ("" para a embutida): um snapshot gravado a
+  // partir de outra cena, ou de uma versão antiga desta, é recusado.
+  snapshot_reader(const unsigned char *data, size_t size, const string &path,
+                  const string &scene_path)
+      : data(data), size(size), path(path), scene_path(scene_path) {}
+
+  bool parse() {
+    if (size < sizeof(snapshot_header))
+      return fail("arquivo curto demais");
+    memcpy(&h, data, sizeof(h));
+    if (memcmp(h.magic, snapshot_magic, sizeof(h.magic)) != 0)
+      return fail("nao e um snapshot de cena");
+    if (h.endian != endian_mark)
+      return fail("gravado em maquina de outra ordem de bytes");
+    if (h.version != snapshot_version)
+      return fail("versao " + to_string(h.version) + " (esperada " +
+                  to_string(snapshot_version) + ")");
+    if (h.file_size != size)
+      return fail("tamanho nao confere (arquivo truncado?)");
+
+    size_t elem[SECTION_COUNT] = {
+        1, sizeof(double), sizeof(texture_record), sizeof(material_record),
+        sizeof(node_record), sizeof(uint32_t), sizeof(uint32_t),
+        sizeof(light_record), sizeof(registry_record), sizeof(bvh_record),
+        sizeof(uint32_t)};
+    for (int s = 0; s < SECTION_COUNT; s++) {
+      const section_entry &e = h.sections[s];
+      if (e.offset % 8 != 0 || e.offset > size ||
+          e.count > (size - e.offset) / elem[s])
+        return fail("secao " + to_string(s) + " fora do arquivo");
+    }
+    if (count(STRINGS) == 0 || table<char>(STRINGS)[count(STRINGS) - 1] != 0)
+      return fail("tabela de textos sem terminador");
+    if (!valid_text(h.scene_file) || !valid_text(h.builtin_build))
+      return fail("cabecalho invalido");
+    if (!same_source())
+      return false;
+
+    return read_textures() && read_materials() && read_nodes() &&
+           read_lights() && read_registry() && read_bvh();
+  }
+
+  // Substitui a cena atual pela lida.
+  void apply() {
+    world.clear();
+    for (uint32_t i : index_table(WORLD))
+      world.add(nodes[i]);
+
+    lights = loaded_lights;
+    firefly_lights = loaded_fireflies;
+    sword_light_ptr = loaded_sword;
+    object_states = loaded_states;
+    initial_object_states = loaded_initial;
+    object_transforms = loaded_transforms;
+
+    mat_metal_ptr = h.metal_material >= 0 ? materials[h.metal_material]
+                                          : nullptr;
+    is_night_mode = h.night_mode != 0;
+    blade_shine_enabled = h.blade_shine != 0;
+    scene_file_path = text(h.scene_file);
+
+    cam_eye = get_vec(h.eye);
+    cam_at = get_vec(h.at);
+    cam_up = get_vec(h.up);
+    ambient.intensity = get_color(h.ambient);
+    sky_color_top = get_color(h.sky_top);
+    sky_color_bottom = get_color(h.sky_bottom);
+
+    scene_bvh.bvh_root = h.bvh_root >= 0 ? bvh[h.bvh_root] : nullptr;
+    scene_bvh.unbounded_objects.clear();
+    for (uint32_t i : index_table(UNBOUNDED))
+      scene_bvh.unbounded_objects.push_back(nodes[i]);
+    scene_bvh.flatten();
+  }
+
+  size_t node_total() const { return nodes.size(); }
+  size_t bvh_total() const { return bvh.size(); }
+
+private:
+  const unsigned char *data;
+  size_t size;
+  string path;
+  string scene_path;
+  snapshot_header h;
+
+  vector<shared_ptr<texture>> textures;
+  vector<shared_ptr<material>> materials;
+  vector<shared_ptr<hittable>> nodes;
+  vector<shared_ptr<bvh_node>> bvh;
+  vector<shared_ptr<light>> loaded_lights;
+  vector<shared_ptr<light>> loaded_fireflies;
+  shared_ptr<light> loaded_sword;
+  map<string, TransformState> loaded_states;
+  map<string, TransformState> loaded_initial;
+  map<string, shared_ptr<class transform>> loaded_transforms;
+
+  // Confere se o snapshot foi gravado a partir da cena pedida, e dela como
+  // está agora.
+  bool same_source() {
+    if (text(h.scene_file) != scene_path)
+      return fail("gravado para " + scene_name(text(h.scene_file)) +
+                  ", pedida " + scene_name(scene_path));
+    if (scene_path.empty()) {
+      if (string(text(h.builtin_build)) != builtin_scene_build_id())
+        return fail("cena embutida de outra compilacao");
+      return true;
+    }
+    mip_image::source_stamp stamp;
+    if (!texture_cache::stat_source(scene_path, stamp) ||
+        stamp.mtime != h.source_mtime || stamp.size != h.source_size)
+      return fail(scene_path + " mudou desde a gravacao");
+    return true;
+  }
+
+  static string scene_name(const string &scene_path) {
+    return scene_path.empty() ? "a cena embutida" : scene_path;
+  }
+
+  bool fail(const string &message) {
+    cerr << "Snapshot " << path << ": " << message << "\n";
+    return false;
+  }
+
+  uint64_t count(section_id s) const { return h.sections[s].count; }
+
+  // O mapeamento começa alinhado à página e as seções a 8 bytes, então os
+  // registros podem ser lidos no lugar.
+  template <typename T> const T *table(section_id s) const {
+    return reinterpret_cast<const T *>(data + h.sections[s].offset);
+  }
+
+  struct index_range {
+    const uint32_t *first, *last;
+    const uint32_t *begin() const { return first; }
+    const uint32_t *end() const { return last; }
+  };
+
+  index_range index_table(section_id s) const {
+    const uint32_t *first = table<uint32_t>(s);
+    return {first, first + count(s)};
+  }
+
+  bool valid_text(uint32_t id) const { return id < count(STRINGS); }
+  const char *text(uint32_t id) const { return table<char>(STRINGS) + id; }
+
+  bool read_textures() {
+    const texture_record *records = table<texture_record>(TEXTURES);
+    for (uint64_t i = 0; i < count(TEXTURES); i++) {
+      const texture_record &r = records[i];
+      shared_ptr<texture> t;
+      switch (r.kind) {
+      case texture_kind::SOLID:
+        t = make_shared<solid_color>(get_color(r.a));
+        break;
+      case texture_kind::CHECKER:
+        t = make_shared<checker_texture>(get_color(r.a), get_color(r.b),
+                                         r.scale);
+        break;
+      case texture_kind::STONE:
+        t = make_shared<stone_texture>(get_color(r.a), r.scale);
+        break;
+      case texture_kind::METAL:
+        t = make_shared<metal_texture>(get_color(r.a));
+        break;
+      case texture_kind::IMAGE:
+      case texture_kind::TILED:
+        if (!valid_text(r.path))
+          return fail("caminho de textura invalido");
+        // As imagens vêm do texture_cache (e do seu cache em disco), como
+        // na construção normal da cena.
+        if (r.kind == texture_kind::IMAGE)
+          t = make_shared<image_texture>(text(r.path));
+        else
+          t = make_shared<tiled_image_texture>(text(r.path), r.scale);
+        break;
+      default:
+        return fail("tipo de textura invalido");
+      }
+      textures.push_back(t);
+    }
+    return true;
+  }
+
+  bool read_materials() {
+    const material_record *records = table<material_record>(MATERIALS);
+    for (uint64_t i = 0; i < count(MATERIALS); i++) {
+      const material_record &r = records[i];
+      if (r.kd >= static_cast<int64_t>(textures.size()) ||
+          !valid_text(r.name) ||
+          r.filter > static_cast<uint32_t>(texture_filter::TRILINEAR))
+        return fail("material " + to_string(i) + " invalido");
+      auto m = make_shared<material>();
+      if (r.kd >= 0)
+        m->kd = textures[r.kd];
+      m->ka = get_color(r.ka);
+      m->ks = get_color(r.ks);
+      m->emission = get_color(r.emission);
+      m->shininess = r.shininess;
+      m->filter = static_cast<texture_filter>(r.filter);
+      m->name = text(r.name);
+      materials.push_back(m);
+    }
+    return true;
+  }
+
+  bool read_nodes() {
+    const node_record *records = table<node_record>(NODES);
+    const double *params = table<double>(PARAMS);
+    const uint32_t *children = table<uint32_t>(CHILDREN);
+    nodes.reserve(count(NODES));
+
+    for (uint64_t i = 0; i < count(NODES); i++) {
+      const node_record &r = records[i];
+      uint32_t kind = static_cast<uint32_t>(r.kind);
+      if (kind > static_cast<uint32_t>(node_kind::TRANSFORM) ||
+          r.first_param > count(PARAMS) ||
+          param_count[kind] > count(PARAMS) - r.first_param ||
+          r.first_child > count(CHILDREN) ||
+          r.child_count > count(CHILDREN) - r.first_child ||
+          !valid_text(r.name) ||
+          r.material >= static_cast<int64_t>(materials.size()))
+        return fail("no " + to_string(i) + " invalido");
+
+      // Os filhos são gravados antes dos pais; um índice adiante só aparece
+      // em arquivo corrompido (e criaria um ciclo).
+      const uint32_t *kids = children + r.first_child;
+      for (uint32_t k = 0; k < r.child_count; k++)
+        if (kids[k] >= i)
+          return fail("no " + to_string(i) + " com filho invalido");
+
+      const double *p = params + r.first_param;
+      shared_ptr<material> m = r.material >= 0 ? materials[r.material]
+                                               : nullptr;
+      string name = text(r.name);
+      shared_ptr<hittable> obj;
+
+      switch (r.kind) {
+      case node_kind::SPHERE:
+        obj = make_shared<sphere>(get_vec(p), p[3], m, name);
+        break;
+      case node_kind::CYLINDER:
+        obj = make_shared<cylinder>(get_vec(p), get_vec(p + 3), p[6], p[7], m,
+                                    name);
+        break;
+      case node_kind::CONE:
+        obj = make_shared<cone>(get_vec(p), get_vec(p + 3), p[6], p[7], m,
+                                name);
+        break;
+      case node_kind::PLANE:
+        obj = make_shared<plane>(get_vec(p), get_vec(p + 3), m, name);
+        break;
+      case node_kind::TRIANGLE:
+        obj = make_shared<triangle>(get_vec(p), get_vec(p + 3), get_vec(p + 6),
+                                    m, name);
+        break;
+      case node_kind::BOX:
+        obj = make_shared<box_mesh>(get_vec(p), get_vec(p + 3), m, name);
+        break;
+      case node_kind::BLADE: {
+        auto blade = make_shared<blade_mesh>();
+        blade->mat = m;
+        blade->name = name;
+        for (uint32_t k = 0; k < r.child_count; k++)
+          blade->faces.add(nodes[kids[k]]);
+        obj = blade;
+        break;
+      }
+      case node_kind::LIST: {
+        auto list = make_shared<hittable_list>();
+        list->objects.reserve(r.child_count);
+        for (uint32_t k = 0; k < r.child_count; k++)
+          list->add(nodes[kids[k]]);
+        obj = list;
+        break;
+      }
+      case node_kind::TRANSFORM: {
+        if (r.child_count != 1)
+          return fail("transform " + to_string(i) + " sem objeto");
+        mat4 fwd, inv;
+        for (int a = 0; a < 4; a++)
+          for (int b = 0; b < 4; b++) {
+            fwd.m[a][b] = p[a * 4 + b];
+            inv.m[a][b] = p[16 + a * 4 + b];
+          }
+        auto t = instance_object(nodes[kids[0]], fwd, inv, m);
+        t->name = name;
+        obj = t;
+        break;
+      }
+      }
+      nodes.push_back(obj);
+    }
+
+    for (uint32_t i : index_table(WORLD))
+      if (i >= nodes.size())
+        return fail("objeto do mundo invalido");
+    for (uint32_t i : index_table(UNBOUNDED))
+      if (i >= nodes.size())
+        return fail("objeto sem bounding box invalido");
+    return true;
+  }
+
+  bool read_lights() {
+    const light_record *records = table<light_record>(LIGHTS);
+    for (uint64_t i = 0; i < count(LIGHTS); i++) {
+      const light_record &r = records[i];
+      if (!valid_text(r.name))
+        return fail("luz " + to_string(i) + " invalida");
+      string name = text(r.name);
+      color intensity = get_color(r.intensity);
+      const double *att = r.attenuation;
+
+      shared_ptr<light> l;
+      switch (r.kind) {
+      case light_kind::POINT:
+        l = make_shared<point_light>(get_vec(r.position), intensity, att[0],
+                                     att[1], att[2], name);
+        break;
+      case light_kind::SPOT:
+        l = make_shared<spot_light>(get_vec(r.position), get_vec(r.direction),
+                                    intensity, r.inner, r.outer, att[0],
+                                    att[1], att[2], name);
+        break;
+      case light_kind::DIRECTIONAL: {
+        auto d = make_shared<directional_light>(get_vec(r.direction),
+                                                intensity, name);
+        d->position = get_vec(r.position);
+        d->target = get_vec(r.target);
+        l = d;
+        break;
+      }
+      default:
+        return fail("tipo de luz invalido");
+      }
+      l->enabled = (r.flags & LIGHT_ENABLED) != 0;
+      l->is_static = (r.flags & LIGHT_STATIC) != 0;
+      l->reach = r.reach;
+
+      loaded_lights.push_back(l);
+      if (r.flags & LIGHT_FIREFLY)
+        loaded_fireflies.push_back(l);
+      if (r.flags & LIGHT_SWORD)
+        loaded_sword = l;
+    }
+    return true;
+  }
+
+  bool read_registry() {
+    const registry_record *records = table<registry_record>(REGISTRY);
+    for (uint64_t i = 0; i < count(REGISTRY); i++) {
+      const registry_record &r = records[i];
+      if (!valid_text(r.name) ||
+          r.transform >= static_cast<int64_t>(nodes.size()))
+        return fail("registro " + to_string(i) + " invalido");
+      string name = text(r.name);
+      if (r.transform >= 0) {
+        auto t = dynamic_pointer_cast<class transform>(nodes[r.transform]);
+        if (!t)
+          return fail("registro '" + name + "' sem transform");
+        loaded_transforms[name] = t;
+      }
+      if (r.has_state)
+        loaded_states[name] = get_state(r.state);
+      if (r.has_initial)
+        loaded_initial[name] = get_state(r.initial);
+    }
+    return true;
+  }
+
+  // Religa a árvore com as caixas gravadas: nenhuma ordenação nem
+  // bounding_box() dos objetos.
+  bool read_bvh() {
+    const bvh_record *records = table<bvh_record>(BVH);
+    bvh.reserve(count(BVH));
+    for (uint64_t i = 0; i < count(BVH); i++) {
+      const bvh_record &r = records[i];
+      auto node = make_shared<bvh_node>();
+      if (!bvh_child(r.left, i, node->left) ||
+          !bvh_child(r.right, i, node->right))
+        return fail("no da BVH " + to_string(i) + " invalido");
+      if (r.axis > 2)
+        return fail("no da BVH " + to_string(i) + " invalido");
+      node->box = aabb(get_vec(r.min), get_vec(r.max));
+      node->axis = static_cast<int>(r.axis);
+      bvh.push_back(node);
+    }
+    if (h.bvh_root >= static_cast<int64_t>(bvh.size()))
+      return fail("raiz da BVH invalida");
+    return true;
+  }
+
+  bool bvh_child(int32_t ref, uint64_t self, shared_ptr<hittable> &out) {
+    if (ref >= 0) {
+      if (static_cast<uint64_t>(ref) >= self)
+        return false;
+      out = bvh[ref];
+      return true;
+    }
+    int64_t node = -static_cast<int64_t>(ref) - 1;
+    if (node >= static_cast<int64_t>(nodes.size()))
+      return false;
+    out = nodes[node];
+    return true;
+  }
+};
+
+} // namespace
+
+namespace scene_snapshot {
+
+bool write(const string &path) {
+  snapshot_writer writer;
+  if (!writer.collect() || !writer.save(path)) {
+    cerr << "Erro ao gravar o snapshot " << path << "\n";
+    return false;
+  }
+  cout << "Snapshot gravado em " << path << ": " << writer.node_total()
+       << " nos, " << writer.bvh_total() << " nos de BVH\n";
+  return true;
+}
+
+bool read(const string &path, const string &scene_path) {
+  mapped_file file;
+  if (!file.open(path.c_str()))
+    return false;
+
+  texture_cache::instance().reset_stats();
+  snapshot_reader reader(file.data(), file.size(), path, scene_path);
+  if (!reader.parse())
+    return false;
+  reader.apply();
+  texture_cache::instance().report_when_idle();
+  setup_camera();
+
+  cout << "Snapshot carregado de " << path << ": " << reader.node_total()
+       << " nos, " << reader.bvh_total() << " nos de BVH\n";
+  return true;
+}
+
+} // namespace scene_snapshot